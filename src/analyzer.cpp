@@ -26,13 +26,168 @@
 #include <calf/modules_dev.h>
 #include <sys/time.h>
 #include <calf/utils.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
 
 using namespace dsp;
 using namespace calf_plugins;
 
+/// The thread running the FFTs of all analyzers that have a GUI looking at
+/// them; it only exists while there is at least one of those
+struct calf_plugins::analyzer_worker
+{
+    static pthread_mutex_t mutex;
+    static std::vector<const analyzer *> analyzers;
+    static pthread_t thread;
+    /// Incremented for every thread started, so that a thread being
+    /// stopped notices even if another one was started in the meantime
+    static int generation;
+    static bool running;
+    
+    static void add(const analyzer *a)
+    {
+        pthread_mutex_lock(&mutex);
+        analyzers.push_back(a);
+        if (!running) {
+            running = true;
+            generation++;
+            pthread_create(&thread, NULL, run, (void *)(intptr_t)generation);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    static void remove(const analyzer *a)
+    {
+        pthread_t stopped;
+        bool stop = false;
+        pthread_mutex_lock(&mutex);
+        analyzers.erase(std::remove(analyzers.begin(), analyzers.end(), a), analyzers.end());
+        if (analyzers.empty() and running) {
+            running = false;
+            stopped = thread;
+            stop = true;
+        }
+        pthread_mutex_unlock(&mutex);
+        if (stop)
+            pthread_join(stopped, NULL);
+    }
+    static void *run(void *arg)
+    {
+        int my_generation = (int)(intptr_t)arg;
+        while(true) {
+            pthread_mutex_lock(&mutex);
+            if (!running or generation != my_generation) {
+                pthread_mutex_unlock(&mutex);
+                break;
+            }
+            for (size_t i = 0; i < analyzers.size(); i++)
+                analyzers[i]->run_fft();
+            pthread_mutex_unlock(&mutex);
+            usleep(5000);
+        }
+        return NULL;
+    }
+};
+
+pthread_mutex_t analyzer_worker::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<const analyzer *> analyzer_worker::analyzers;
+pthread_t analyzer_worker::thread;
+int analyzer_worker::generation = 0;
+bool analyzer_worker::running = false;
+
 #define sinc(x) (x == 0) ? 1 : sin(M_PI * x)/(M_PI * x);
 #define RGBAtoINT(r, g, b, a) ((uint32_t)(r * 255) << 24) + ((uint32_t)(g * 255) << 16) + ((uint32_t)(b * 255) << 8) + (uint32_t)(a * 255)
 
+/// Pack the parameters the worker thread needs into one word (8 bits each)
+static inline int pack_fft_params(int acc, int mode, int windowing)
+{
+    return (acc & 255) | ((mode & 255) << 8) | ((windowing & 255) << 16);
+}
+
+/// @return factor of the selected windowing function for sample i of the FFT input
+static float window_factor(int windowing, int i, int points)
+{
+    float _f = 1.f;
+    float _a, a0, a1, a2, a3;
+    switch(windowing) {
+        case 0:
+        default:
+            // Linear
+            _f = 1.f;
+            break;
+        case 1:
+            // Hamming
+            _f = 0.54 + 0.46 * cos(2 * M_PI * (i - 2 / points));
+            break;
+        case 2:
+            // von Hann
+            _f = 0.5 * (1 + cos(2 * M_PI * (i - 2 / points)));
+            break;
+        case 3:
+            // Blackman
+            _a = 0.16;
+            a0 = 1.f - _a / 2.f;
+            a1 = 0.5;
+            a2 = _a / 2.f;
+            _f = a0 + a1 * cos((2.f * M_PI * i) / points - 1) + \
+                a2 * cos((4.f * M_PI * i) / points - 1);
+            break;
+        case 4:
+            // Blackman-Harris
+            a0 = 0.35875;
+            a1 = 0.48829;
+            a2 = 0.14128;
+            a3 = 0.01168;
+            _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
+                a2 * cos((4.f * M_PI * i) / points - 1) - \
+                a3 * cos((6.f * M_PI * i) / points - 1);
+            break;
+        case 5:
+            // Blackman-Nuttall
+            a0 = 0.3653819;
+            a1 = 0.4891775;
+            a2 = 0.1365995;
+            a3 = 0.0106411;
+            _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
+                a2 * cos((4.f * M_PI * i) / points - 1) - \
+                a3 * cos((6.f * M_PI * i) / points - 1);
+            break;
+        case 6:
+            // Sine
+            _f = sin((M_PI * i) / (points - 1));
+            break;
+        case 7:
+            // Lanczos
+            _f = sinc((2.f * i) / (points - 1) - 1);
+            break;
+        case 8:
+            // Gauß
+            _a = 2.718281828459045;
+            _f = pow(_a, -0.5f * pow((i - (points - 1) / 2) / (0.4 * (points - 1) / 2.f), 2));
+            break;
+        case 9:
+            // Bartlett
+            _f = (2.f / (points - 1)) * (((points - 1) / 2.f) - \
+                fabs(i - ((points - 1) / 2.f)));
+            break;
+        case 10:
+            // Triangular
+            _f = (2.f / points) * ((2.f / points) - fabs(i - ((points - 1) / 2.f)));
+            break;
+        case 11:
+            // Bartlett-Hann
+            a0 = 0.62;
+            a1 = 0.48;
+            a2 = 0.38;
+            _f = a0 - a1 * fabs((i / (points - 1)) - 0.5) - \
+                a2 * cos((2 * M_PI * i) / (points - 1));
+            break;
+    }
+    return _f;
+}
+
 analyzer::analyzer() {
     _accuracy       = -1;
     _acc            = -1;
@@ -47,36 +202,91 @@ analyzer::analyzer() {
     _view           = -1;
     _windowing      = -1;
     _speed          = -1;
-    fpos            = 0;
+    fed             = 0;
+    written         = 0;
     _draw_upper     = 0;
     sanitize        = true;
     recreate_plan   = true;
     
-    spline_buffer = (int*) calloc(200, sizeof(int));
-    
-    fft_buffer = (float*) calloc(max_fft_buffer_size, sizeof(float));
-    
-    fft_inL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_outL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_inR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_outR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_smoothL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_smoothR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_deltaL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_deltaR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_holdL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_holdR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_freezeL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_freezeR = (float*) calloc(max_fft_cache_size, sizeof(float));
+    // the buffers are only allocated when a GUI asks for a graph (see wake)
+    spline_buffer   = NULL;
+    fft_buffer      = NULL;
+    fft_temp        = NULL;
+    fft_inL = fft_outL = fft_inR = fft_outR = NULL;
+    fft_smoothL = fft_smoothR = fft_deltaL = fft_deltaR = NULL;
+    fft_holdL = fft_holdR = fft_freezeL = fft_freezeR = NULL;
+    for (int i = 0; i < 3; i++)
+        spectrum[i][0] = spectrum[i][1] = NULL;
+    spectrum_front  = 0;
+    spectrum_middle = 1;
+    spectrum_back   = 2;
+    fft_request     = 0;
+    fft_points      = 0;
+    fft_params      = -1;
+    feed            = NULL;
+    idle_samples    = 0;
+    idle_timeout    = 44100 * 5;
     
     analyzer_phase_drawn = 0;
 }
 analyzer::~analyzer()
 {
+    free_buffers();
+}
+void analyzer::wake() const
+{
+    idle_samples = 0;
+    if (feed)
+        return;
+    if (!fft_buffer) {
+        spline_buffer = (int*) calloc(200, sizeof(int));
+        
+        fft_buffer = (float*) calloc(ring_pairs * 2, sizeof(float));
+        fft_temp = (dsp::fft<float, MAX_FFT_ORDER>::complex *) calloc(1 << (MAX_FFT_ORDER - 1), sizeof(*fft_temp));
+        
+        fft_inL = (float*) calloc(max_fft_cache_size, sizeof(float));
+        fft_inR = (float*) calloc(max_fft_cache_size, sizeof(float));
+        for (int i = 0; i < 3; i++) {
+            spectrum[i][0] = (float*) calloc(max_fft_cache_size, sizeof(float));
+            spectrum[i][1] = (float*) calloc(max_fft_cache_size, sizeof(float));
+        }
+        spectrum_front  = 0;
+        spectrum_middle = 1;
+        spectrum_back   = 2;
+        fft_outL = spectrum[spectrum_front][0];
+        fft_outR = spectrum[spectrum_front][1];
+        
+        fft_smoothL = (float*) calloc(max_fft_cache_size, sizeof(float));
+        fft_smoothR = (float*) calloc(max_fft_cache_size, sizeof(float));
+        
+        fft_deltaL = (float*) calloc(max_fft_cache_size, sizeof(float));
+        fft_deltaR = (float*) calloc(max_fft_cache_size, sizeof(float));
+        
+        fft_holdL = (float*) calloc(max_fft_cache_size, sizeof(float));
+        fft_holdR = (float*) calloc(max_fft_cache_size, sizeof(float));
+        
+        fft_freezeL = (float*) calloc(max_fft_cache_size, sizeof(float));
+        fft_freezeR = (float*) calloc(max_fft_cache_size, sizeof(float));
+        
+        fed = 0;
+        written = 0;
+        sanitize = true;
+        analyzer_worker::add(this);
+    }
+    // make the buffers visible before the audio thread can start writing to them
+    __sync_synchronize();
+    feed = fft_buffer;
+}
+void analyzer::release_idle() const
+{
+    if (fft_buffer and !feed)
+        free_buffers();
+}
+void analyzer::free_buffers() const
+{
+    if (!fft_buffer)
+        return;
+    analyzer_worker::remove(this);
     free(fft_freezeR);
     free(fft_freezeL);
     free(fft_holdR);
@@ -85,15 +295,26 @@ analyzer::~analyzer()
     free(fft_deltaL);
     free(fft_smoothR);
     free(fft_smoothL);
-    free(fft_outR);
-    free(fft_outL);
+    for (int i = 0; i < 3; i++) {
+        free(spectrum[i][0]);
+        free(spectrum[i][1]);
+        spectrum[i][0] = spectrum[i][1] = NULL;
+    }
     free(fft_inR);
     free(fft_inL);
+    free(fft_temp);
     free(fft_buffer);
     free(spline_buffer);
+    spline_buffer = NULL;
+    fft_buffer = NULL;
+    fft_temp = NULL;
+    fft_inL = fft_outL = fft_inR = fft_outR = NULL;
+    fft_smoothL = fft_smoothR = fft_deltaL = fft_deltaR = NULL;
+    fft_holdL = fft_holdR = fft_freezeL = fft_freezeR = NULL;
 }
 void analyzer::set_sample_rate(uint32_t sr) {
     srate = sr;
+    idle_timeout = sr * 5;
 }
 
 void analyzer::set_params(float resolution, float offset, int accuracy, int hold, int smoothing, int mode, int scale, int post, int speed, int windowing, int view, int freeze)
@@ -134,14 +355,9 @@ void analyzer::set_params(float resolution, float offset, int accuracy, int hold
         _offset = offset;
         redraw_graph = true;
     }
+    // the worker thread reads these together, so publish them in one go
+    fft_params = pack_fft_params(_acc, _mode, _windowing);
 }
-void analyzer::process(float L, float R) {
-    fft_buffer[fpos] = L;
-    fft_buffer[fpos + 1] = R;
-    fpos += 2;
-    fpos %= (max_fft_buffer_size - 2);
-}
-
 bool analyzer::do_fft(int subindex, int points) const
 {
     if (recreate_plan) {
@@ -151,8 +367,6 @@ bool analyzer::do_fft(int subindex, int points) const
     }
     if (sanitize) {
         // null the overall buffer
-        dsp::zero(fft_inL,     max_fft_cache_size);
-        dsp::zero(fft_inR,     max_fft_cache_size);
         dsp::zero(fft_outL,    max_fft_cache_size);
         dsp::zero(fft_outR,    max_fft_cache_size);
         dsp::zero(fft_holdL,   max_fft_cache_size);
@@ -179,143 +393,19 @@ bool analyzer::do_fft(int subindex, int points) const
     
     if(subindex == 0) {
         // #####################################################################
-        // We are doing FFT here, so we first have to setup fft-buffers from
-        // the main buffer and we use this cycle for filling other buffers
-        // like smoothing, delta and hold
+        // The FFT itself runs in the worker thread (see run_fft), here we
+        // only ask for a new one and pick up the result once it's there. We
+        // use this cycle for filling other buffers like smoothing, delta and
+        // hold
         // #####################################################################
         if(!((int)analyzer_phase_drawn % __speed)) {
-            // seems we have to do a fft, so let's read the latest data from the
-            // buffer to send it to fft afterwards
+            fft_points = points;
+            fft_request = 1;
+        }
+        if(spectrum_middle & spectrum_fresh) {
             // we want to remember old fft_out values for smoothing as well
             // and we fill the hold buffer in this (extra) cycle
             for(int i = 0; i < _accuracy; i++) {
-                // go to the right position back in time according to accuracy
-                // settings and cycling in the main buffer
-                int _fpos = (fpos - _accuracy * 2 \
-                    + (i * 2)) % max_fft_buffer_size;
-                if(_fpos < 0)
-                    _fpos = max_fft_buffer_size + _fpos;
-                float L = fft_buffer[_fpos];
-                float R = fft_buffer[_fpos + 1];
-                float win = 0.54 - 0.46 * cos(2 * M_PI * i / _accuracy);
-                L *= win;
-                R *= win;
-                
-                // #######################################
-                // Do some windowing functions on the
-                // buffer
-                // #######################################
-                int _m = 2;
-                float _f = 1.f;
-                float _a, a0, a1, a2, a3;
-                switch(_windowing) {
-                    case 0:
-                    default:
-                        // Linear
-                        _f = 1.f;
-                        break;
-                    case 1:
-                        // Hamming
-                        _f = 0.54 + 0.46 * cos(2 * M_PI * (i - 2 / points));
-                        break;
-                    case 2:
-                        // von Hann
-                        _f = 0.5 * (1 + cos(2 * M_PI * (i - 2 / points)));
-                        break;
-                    case 3:
-                        // Blackman
-                        _a = 0.16;
-                        a0 = 1.f - _a / 2.f;
-                        a1 = 0.5;
-                        a2 = _a / 2.f;
-                        _f = a0 + a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1);
-                        break;
-                    case 4:
-                        // Blackman-Harris
-                        a0 = 0.35875;
-                        a1 = 0.48829;
-                        a2 = 0.14128;
-                        a3 = 0.01168;
-                        _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1) - \
-                            a3 * cos((6.f * M_PI * i) / points - 1);
-                        break;
-                    case 5:
-                        // Blackman-Nuttall
-                        a0 = 0.3653819;
-                        a1 = 0.4891775;
-                        a2 = 0.1365995;
-                        a3 = 0.0106411;
-                        _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1) - \
-                            a3 * cos((6.f * M_PI * i) / points - 1);
-                        break;
-                    case 6:
-                        // Sine
-                        _f = sin((M_PI * i) / (points - 1));
-                        break;
-                    case 7:
-                        // Lanczos
-                        _f = sinc((2.f * i) / (points - 1) - 1);
-                        break;
-                    case 8:
-                        // Gauß
-                        _a = 2.718281828459045;
-                        _f = pow(_a, -0.5f * pow((i - (points - 1) / 2) / (0.4 * (points - 1) / 2.f), 2));
-                        break;
-                    case 9:
-                        // Bartlett
-                        _f = (2.f / (points - 1)) * (((points - 1) / 2.f) - \
-                            fabs(i - ((points - 1) / 2.f)));
-                        break;
-                    case 10:
-                        // Triangular
-                        _f = (2.f / points) * ((2.f / points) - fabs(i - ((points - 1) / 2.f)));
-                        break;
-                    case 11:
-                        // Bartlett-Hann
-                        a0 = 0.62;
-                        a1 = 0.48;
-                        a2 = 0.38;
-                        _f = a0 - a1 * fabs((i / (points - 1)) - 0.5) - \
-                            a2 * cos((2 * M_PI * i) / (points - 1));
-                        break;
-                }
-                L *= _f;
-                if(_mode > _m)
-                    R *= _f;
-
-                // perhaps we need to compute two FFT's, so store left and right
-                // channel in case we need only one FFT, the left channel is
-                // used as 'standard'"
-                float valL;
-                float valR;
-                
-                switch(_mode) {
-                    default:
-                        // left channel (mode 1)
-                        // or both channels (mode 3, 4, 5, 7, 9, 10)
-                        valL = L;
-                        valR = R;
-                        break;
-                    case 0:
-                    case 6:
-                        // average (mode 0)
-                        valL = (L + R) / 2;
-                        valR = (L + R) / 2;
-                        break;
-                    case 2:
-                    case 8:
-                        // right channel (mode 2)
-                        valL = R;
-                        valR = L;
-                        break;
-                }
-                // store values in analyzer buffer
-                fft_inL[i] = valL;
-                fft_inR[i] = valR;
-                
                 // fill smoothing & falling buffer
                 if(_smooth == 2) {
                     fft_smoothL[i] = fft_outL[i];
@@ -340,15 +430,10 @@ bool analyzer::do_fft(int subindex, int points) const
                     fft_holdR[i] = fabs(fft_outR[i]);
             }
             
-            // run fft
-            // this takes our latest buffer and returns an array with
-            // non-normalized
-            fft.execute_r2r(_acc + 7, fft_inL, fft_outL, fft_temp, false);
-            //run fft for for right channel too. it is needed for stereo image 
-            //and stereo difference modes
-            if(_mode >= 3) {
-                fft.execute_r2r(_acc + 7, fft_inR, fft_outR, fft_temp, false);
-            }
+            // swap the new spectrum in, our old one goes back to the worker
+            spectrum_front = __sync_lock_test_and_set(&spectrum_middle, spectrum_front) & ~spectrum_fresh;
+            fft_outL = spectrum[spectrum_front][0];
+            fft_outR = spectrum[spectrum_front][1];
             // ...and set some values for later use
             analyzer_phase_drawn = 0;     
             fftdone = true;  
@@ -358,6 +443,92 @@ bool analyzer::do_fft(int subindex, int points) const
     return fftdone;
 }
 
+void analyzer::run_fft() const
+{
+    if (!fft_request)
+        return;
+    fft_request = 0;
+    int params = fft_params;
+    if (params < 0)
+        return;
+    int order = (params & 255) + 7, mode = (params >> 8) & 255, windowing = (params >> 16) & 255;
+    int accuracy = 1 << order, points = fft_points;
+    if (accuracy > max_fft_cache_size)
+        return;
+    
+    // read the latest data from the ring buffer to send it to fft afterwards
+    __sync_synchronize();
+    uint32_t end = written;
+    uint32_t start = end - accuracy;
+    for(int i = 0; i < accuracy; i++) {
+        int _fpos = ((start + i) & (ring_pairs - 1)) * 2;
+        float L = fft_buffer[_fpos];
+        float R = fft_buffer[_fpos + 1];
+        float win = 0.54 - 0.46 * cos(2 * M_PI * i / accuracy);
+        L *= win;
+        R *= win;
+        
+        // #######################################
+        // Do some windowing functions on the
+        // buffer
+        // #######################################
+        int _m = 2;
+        float _f = window_factor(windowing, i, points);
+        L *= _f;
+        if(mode > _m)
+            R *= _f;
+
+        // perhaps we need to compute two FFT's, so store left and right
+        // channel in case we need only one FFT, the left channel is
+        // used as 'standard'"
+        float valL;
+        float valR;
+        
+        switch(mode) {
+            default:
+                // left channel (mode 1)
+                // or both channels (mode 3, 4, 5, 7, 9, 10)
+                valL = L;
+                valR = R;
+                break;
+            case 0:
+            case 6:
+                // average (mode 0)
+                valL = (L + R) / 2;
+                valR = (L + R) / 2;
+                break;
+            case 2:
+            case 8:
+                // right channel (mode 2)
+                valL = R;
+                valR = L;
+                break;
+        }
+        // store values in analyzer buffer
+        fft_inL[i] = valL;
+        fft_inR[i] = valR;
+    }
+    // the audio thread kept writing in the meantime - if it got around the
+    // ring to the oldest sample we used, the snapshot is torn, try again
+    __sync_synchronize();
+    if (written + publish_interval - start > (uint32_t)ring_pairs) {
+        fft_request = 1;
+        return;
+    }
+    
+    // run fft
+    // this takes our latest buffer and returns an array with
+    // non-normalized
+    fft.execute_r2r(order, fft_inL, spectrum[spectrum_back][0], fft_temp, false);
+    //run fft for for right channel too. it is needed for stereo image 
+    //and stereo difference modes
+    if(mode >= 3) {
+        fft.execute_r2r(order, fft_inR, spectrum[spectrum_back][1], fft_temp, false);
+    }
+    // publish it for the GUI
+    spectrum_back = __sync_lock_test_and_set(&spectrum_middle, spectrum_back | spectrum_fresh) & ~spectrum_fresh;
+}
+
 void analyzer::draw(int subindex, float *data, int points, bool fftdone) const
 {
     double freq; // here the frequency of the actual drawn pixel gets stored
@@ -778,6 +949,7 @@ bool analyzer::get_graph(int subindex, int phase, float *data, int points, cairo
 {
     if (!phase)
         return false;
+    wake();
     
     if ((subindex == 1 and !_hold and _mode < 3) \
      or (subindex > 1  and _mode < 3) \
@@ -883,6 +1055,7 @@ bool analyzer::get_moving(int subindex, int &direction, float *data, int x, int
 {
     if ((subindex and _mode != 9) or subindex > 1)
         return false;
+    wake();
     bool fftdone = false;
     if (!subindex)
         fftdone = do_fft(subindex, x);
@@ -1041,6 +1214,7 @@ bool analyzer::get_gridline(int subindex, int phase, float &pos, bool &vertical,
     
 bool analyzer::get_layers(int generation, unsigned int &layers) const
 {
+    release_idle();
     if (_mode > 5 and _mode < 11)
         layers = LG_REALTIME_MOVING;
     else
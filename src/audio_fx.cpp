@@ -25,6 +25,9 @@
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 using namespace calf_plugins;
 using namespace dsp;
@@ -184,25 +187,12 @@ int biquad_filter_module::process_channel(uint16_t channel_no, const float *in,
     }
 
     if (inmask) {
-        switch(order) {
-            case 1:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[0].process(in[i] * lvl_in);
-                    out[i] *= lvl_out;
-                }
-                break;
-            case 2:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[1].process(filter[0].process(in[i] * lvl_in));
-                    out[i] *= lvl_out;
-                }
-                break;
-            case 3:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[2].process(filter[1].process(filter[0].process(in[i] * lvl_in)));
-                    out[i] *= lvl_out;
-                }
-                break;
+        for (uint32_t i = 0; i < numsamples; i++)
+            out[i] = in[i] * lvl_in;
+        dsp::process_block_cascade(filter, order, out, out, numsamples);
+        if (lvl_out != 1.f) {
+            for (uint32_t i = 0; i < numsamples; i++)
+                out[i] *= lvl_out;
         }
     } else {
         if (filter[order - 1].empty())
@@ -346,7 +336,9 @@ void reverb::process(float &left, float &right)
     left = apL5.process_allpass_comb_lerp16(left, tl[4] + 69*lfo, ldec[4]);
     left = apL6.process_allpass_comb_lerp16(left, tl[5] - 46*lfo, ldec[5]);
     old_left = lp_left.process(left * fb);
+#if CALF_SAMPLE_SANITIZE
     sanitize(old_left);
+#endif
 
     right += old_left;
     right = apR1.process_allpass_comb_lerp16(right, tr[0] - 45*lfo, rdec[0]);
@@ -357,7 +349,9 @@ void reverb::process(float &left, float &right)
     right = apR5.process_allpass_comb_lerp16(right, tr[4] + 69*lfo, rdec[4]);
     right = apR6.process_allpass_comb_lerp16(right, tr[5] - 46*lfo, rdec[5]);
     old_right = lp_right.process(right * fb);
+#if CALF_SAMPLE_SANITIZE
     sanitize(old_right);
+#endif
 
     left = out_left, right = out_right;
 }
@@ -415,12 +409,13 @@ void tap_distortion::set_sample_rate(uint32_t sr)
 {
     srate = sr;
     over = srate * 2 > 96000 ? 1 : 2;
-    resampler.set_params(srate, over, 2);
+    // low quality keeps the delay of the distorted signal short (see get_latency)
+    resampler.set_params(srate, over, oversampler::QUALITY_LOW);
 }
 
 float tap_distortion::process(float in)
 {
-    double *samples = resampler.upsample((double)in);
+    float *samples = resampler.upsample(in);
     meter = 0.f;
     for (int o = 0; o < over; o++) {
         float proc = samples[o];
@@ -436,7 +431,7 @@ float tap_distortion::process(float in)
         samples[o] = proc;
         meter = std::max(meter, proc);
     }
-    float out = (float)resampler.downsample(samples);
+    float out = resampler.downsample(samples);
     return out;
 }
 
@@ -603,6 +598,7 @@ lookahead_limiter::lookahead_limiter() {
     asc_active = false;
     nextiter = 0;
     nextlen = 0;
+    next_mask = 0;
     asc = 0.f;
     asc_c = 0;
     asc_pos = -1;
@@ -645,12 +641,20 @@ void lookahead_limiter::set_sample_rate(uint32_t sr)
     srate = sr;
     // rebuild buffer
     overall_buffer_size = (int)(srate * (100.f / 1000.f) * channels) + channels; // buffer size attack rate multiplied by 2 channels
+    free(buffer);
     buffer = (float*) calloc(overall_buffer_size, sizeof(float));
     pos = 0;
 
-    nextdelta = (float*) calloc(overall_buffer_size, sizeof(float));
-    nextpos = (int*) malloc(overall_buffer_size * sizeof(int));
-    memset(nextpos, -1, overall_buffer_size * sizeof(int));
+    // the peak queue never holds more than one entry per lookahead sample
+    // plus the trailing release, round it up for masked indexing
+    int next_size = 1;
+    while(next_size < overall_buffer_size / channels + 2)
+        next_size <<= 1;
+    next_mask = next_size - 1;
+    free(nextdelta);
+    free(nextpos);
+    nextdelta = (float*) calloc(next_size, sizeof(float));
+    nextpos = (int*) calloc(next_size, sizeof(int));
     
     reset();
 }
@@ -671,7 +675,6 @@ void lookahead_limiter::reset() {
     buffer_size = bs - bs % channels; // buffer size attack rate
     _sanitize = true;
     pos = 0;
-    nextpos[0] = -1;
     nextlen = 0;
     nextiter = 0;
     delta = 0.f;
@@ -706,6 +709,24 @@ float lookahead_limiter::get_rdelta(float peak, float _limit, float _att, bool _
     return _rdelta;
 }
 
+inline float lookahead_limiter::get_gain(int p, const float *multi_buffer) const
+{
+    // attenuation needed to bring the stored sample at p down to the limit
+    float _multi_coeff = (use_multi) ? multi_buffer[p] : 1.f;
+    float _peak = fabs(buffer[p]) > fabs(buffer[p + 1]) ? fabs(buffer[p]) : fabs(buffer[p + 1]);
+    return (limit * _multi_coeff * weight) / _peak;
+}
+
+inline float lookahead_limiter::get_walk_delta(int p, float gain, const float *multi_buffer) const
+{
+    // delta walking from the attenuation stored at p to gain at the actual
+    // position
+    int dist = pos - p;
+    if(dist < 0)
+        dist += buffer_size;
+    return (gain - get_gain(p, multi_buffer)) / (dist / channels);
+}
+
 void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
 {
     // PROTIP: harming paying customers enough to make them develop a competing
@@ -721,7 +742,12 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
         buffer[pos] = left;
         buffer[pos + 1] = right;
     }
-    
+
+    // output position: the oldest sample in the lookahead buffer
+    int outpos = pos + channels;
+    if(outpos >= buffer_size)
+        outpos -= buffer_size;
+
     // are we using multiband? get the multiband coefficient or use 1.f
     float multi_coeff = (use_multi) ? multi_buffer[pos] : 1.f;
     
@@ -738,9 +764,6 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     }
 
     if(peak > _limit or multi_coeff < 1.0) {
-        float _multi_coeff = 1.f;
-        float _peak;
-        
         // calc the attenuation needed to reduce incoming peak
         float _att = std::min(_limit / peak, 1.f);
         // calc release without any asc to keep all relevant peaks
@@ -755,63 +778,57 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
             // be more important - we already checked that earlier) and use this
             // delta now. and we have to create a release delta in nextpos buffer
             nextpos[0] = pos;
-            nextpos[1] = -1;
             nextdelta[0] = _rdelta;
             nextlen = 1;
             nextiter = 0;
             delta = _delta;
-        } else {
+        } else if(nextlen) {
             // we have a peak on input its delta is less important than the
-            // actual delta. But what about the stored deltas we're following?
-            bool _found = false;
-            int i = 0;
-            for(i = nextiter; i < nextiter + nextlen; i++) {
-                // walk through our nextpos buffer
-                int j = i % buffer_size;
-                // calculate a delta for the next stored peak
-                // are we using multiband? then get the multi_coeff for the
-                // stored position
-                _multi_coeff = (use_multi) ? multi_buffer[nextpos[j]] : 1.f;
-                // is the left or the right channel on this position more
-                // important?
-                _peak = fabs(buffer[nextpos[j]]) > fabs(buffer[nextpos[j] + 1]) ? fabs(buffer[nextpos[j]]) : fabs(buffer[nextpos[j] + 1]);
-                // calc a delta to use to reach our incoming peak from the
-                // stored position
-                _delta = (_limit / peak - (limit * _multi_coeff * weight) / _peak) / (((buffer_size - nextpos[j] + pos) % buffer_size) / channels);
-                if(_delta < nextdelta[j]) {
-                    // if the buffered delta is more important than the delta
-                    // used to reach our peak from the stored position, store
-                    // the new delta at that position and stop the loop
-                    nextdelta[j] = _delta;
-                    _found = true;
+            // actual delta. The stored positions form a chain of segments
+            // whose slopes only grow towards the back, so every stored
+            // position that the new peak overrides sits at the back of the
+            // queue. Pop those from the back instead of walking the queue from
+            // the front: every position is pushed and popped at most once,
+            // which keeps the cost per sample constant on average no matter
+            // how dense the transients are.
+            int last = (nextiter + nextlen - 1) & next_mask;
+            float _gain = _limit / peak;
+            // calc a delta to use to reach our incoming peak from the stored
+            // position
+            _delta = get_walk_delta(nextpos[last], _gain, multi_buffer);
+            while(nextlen > 1) {
+                int prev = (last - 1) & next_mask;
+                float _pdelta = get_walk_delta(nextpos[prev], _gain, multi_buffer);
+                if(!(_pdelta < nextdelta[prev]))
                     break;
-                }
+                // the peak is reached more gently from the previous position,
+                // so the last one will never be walked to
+                nextlen --;
+                last = prev;
+                _delta = _pdelta;
             }
-            if(_found) {
-                // there was something more important in the next-buffer.
-                // throw away any position and delta after the important
-                // position and add a new release delta
-                nextlen = i - nextiter + 1;
-                nextpos[(nextiter + nextlen) % buffer_size] = pos;
-                nextdelta[(nextiter + nextlen) % buffer_size] = _rdelta;
-                // set the next following position value to -1 (cleaning up the
-                // nextpos buffer)
-                nextpos[(nextiter + nextlen + 1) % buffer_size] = -1;
-                // and raise the length of our nextpos buffer for keeping the
-                // release value
+            if(_delta < nextdelta[last]) {
+                // if the buffered delta is more important than the delta
+                // used to reach our peak from the stored position, store
+                // the new delta at that position and add a new release delta
+                // for the incoming peak behind it
+                nextdelta[last] = _delta;
+                last = (last + 1) & next_mask;
+                nextpos[last] = pos;
+                nextdelta[last] = _rdelta;
                 nextlen ++;
             }
         }
     }
 
     // switch left and right pointers in buffer to output position
-    left = buffer[(pos + channels) % buffer_size];
-    right = buffer[(pos + channels + 1) % buffer_size];
+    left = buffer[outpos];
+    right = buffer[outpos + 1];
 
     // if a peak leaves the buffer, remove it from asc fake buffer
     // but only if we're not sanitizing asc buffer
     float _peak = fabs(left) > fabs(right) ? fabs(left) : fabs(right);
-    float _multi_coeff = (use_multi) ? multi_buffer[(pos + channels) % buffer_size] : 1.f;
+    float _multi_coeff = (use_multi) ? multi_buffer[outpos] : 1.f;
     if(pos == asc_pos and !asc_changed) {
         asc_pos = -1;
     }
@@ -827,7 +844,7 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     left *= att;
     right *= att;
     
-    if((pos + channels) % buffer_size == nextpos[nextiter]) {
+    if(nextlen and outpos == nextpos[nextiter]) {
         // if we reach a buffered position, change the actual delta and erase
         // this (the first) element from nextpos and nextdelta buffer
         if(auto_release) {
@@ -837,10 +854,11 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
                 // if there are more positions to walk to, calc delta to next
                 // position in buffer and compare it to release delta (keep
                 // changes between peaks below asc steepness)
-                int _nextpos = nextpos[(nextiter + 1) % buffer_size];
-                float __peak = fabs(buffer[_nextpos]) > fabs(buffer[_nextpos + 1]) ? fabs(buffer[_nextpos]) : fabs(buffer[_nextpos + 1]);
-                float __multi_coeff = (use_multi) ? multi_buffer[_nextpos] : 1.f;
-                float __delta = ((limit * __multi_coeff * weight) / __peak - att) / (((buffer_size + _nextpos - ((pos + channels) % buffer_size)) % buffer_size) / channels);
+                int _nextpos = nextpos[(nextiter + 1) & next_mask];
+                int _dist = _nextpos - outpos;
+                if(_dist < 0)
+                    _dist += buffer_size;
+                float __delta = (get_gain(_nextpos, multi_buffer) - att) / (_dist / channels);
                 if(__delta < delta) {
                     delta = __delta;
                 }
@@ -852,8 +870,7 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
         }
         // remove first element from circular nextpos buffer
         nextlen -= 1;
-        nextpos[nextiter] = -1;
-        nextiter = (nextiter + 1) % buffer_size;
+        nextiter = (nextiter + 1) & next_mask;
     }
 
     if (att > 1.0f) {
@@ -862,7 +879,6 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
         delta = 0.0f;
         nextiter = 0;
         nextlen = 0;
-        nextpos[0] = -1;
     }
 
     // main limiting party is over, let's cleanup the puke
@@ -899,7 +915,7 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     att_max = (att < att_max) ? att : att_max;
 
     // step forward in our sample ring buffer
-    pos = (pos + channels) % buffer_size;
+    pos = outpos;
 
     // sanitizing is always done after a full cycle through the lookahead buffer
     if(_sanitize and pos == 0) _sanitize = false;
@@ -907,6 +923,12 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     asc_changed = false;
 }
 
+void lookahead_limiter::process_block(float *left, float *right, float *multi_buffer, uint32_t numsamples)
+{
+    for(uint32_t i = 0; i < numsamples; i++)
+        process(left[i], right[i], multi_buffer);
+}
+
 bool lookahead_limiter::get_asc() {
     if(!asc_active) return false;
     asc_active = false;
@@ -1141,6 +1163,24 @@ void crossover::set_level(int b, float l) {
     level[b] = l;
     redraw_graph = std::min(2, redraw_graph + 1);
 }
+void crossover::process_block(float * const *data, float * const *outs, uint32_t numsamples) {
+    for (int c = 0; c < channels; c++) {
+        for(int b = 0; b < bands; b ++) {
+            float *o = outs[b * channels + c];
+            std::copy(data[c], data[c] + numsamples, o);
+            for (int f = 0; f < get_filter_count(); f++){
+                if(b + 1 < bands)
+                    lp[c][b][f].process_block(o, o, numsamples);
+                if(b - 1 >= 0)
+                    hp[c][b - 1][f].process_block(o, o, numsamples);
+            }
+            for (uint32_t i = 0; i < numsamples; i++)
+                o[i] *= level[b];
+            if (numsamples)
+                out[c][b] = o[numsamples - 1];
+        }
+    }
+}
 void crossover::process(float *data) {
     for (int c = 0; c < channels; c++) {
         for(int b = 0; b < bands; b ++) {
@@ -1148,11 +1188,15 @@ void crossover::process(float *data) {
             for (int f = 0; f < get_filter_count(); f++){
                 if(b + 1 < bands) {
                     out[c][b] = lp[c][b][f].process(out[c][b]);
+#if CALF_SAMPLE_SANITIZE
                     lp[c][b][f].sanitize();
+#endif
                 }
                 if(b - 1 >= 0) {
                     out[c][b] = hp[c][b - 1][f].process(out[c][b]);
+#if CALF_SAMPLE_SANITIZE
                     hp[c][b - 1][f].sanitize();
+#endif
                 }
             }
             out[c][b] *= level[b];
@@ -1342,51 +1386,157 @@ bool bitreduction::get_gridline(int subindex, int phase, float &pos, bool &verti
 
 //////////////////////////////////////////////////////////////////
 
-resampleN::resampleN()
+/// Dot product of two float vectors, n is a multiple of 8
+static inline float dot8(const float *a, const float *b, int n)
 {
-    factor  = 2;
-    srate   = 0;
-    filters = 2;
+#if defined(__SSE__)
+    // two accumulators so that the additions don't wait for each other
+    __m128 sum = _mm_setzero_ps(), sum2 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    sum = _mm_add_ps(sum, sum2);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#else
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    for (int i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
 }
-resampleN::~resampleN()
+
+/// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+static double bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+oversampler::oversampler()
 {
+    set_params(44100, 1);
 }
-void resampleN::set_params(uint32_t sr, int fctr = 2, int fltrs = 2)
+
+void oversampler::set_params(uint32_t sr, int fctr, int quality)
 {
-    srate   = sr;
-    factor  = std::min(16, std::max(1, fctr));
-    filters = std::min(4, std::max(1, fltrs));
-    // set all filters
-    filter[0][0].set_lp_rbj(std::max(25000., (double)srate / 2), 0.8, (float)srate * factor);
-    for (int i = 1; i < filters; i++) {
-        filter[0][i].copy_coeffs(filter[0][0]);
-        filter[1][i].copy_coeffs(filter[0][0]);
+    // taps per phase, lowpass cutoff relative to the base Nyquist frequency
+    // and Kaiser window beta for each quality preset
+    static const int quality_taps[] = { 16, 32, 48 };
+    static const double quality_cutoff[] = { 0.96, 0.98, 1.0 };
+    static const double quality_beta[] = { 5.0, 7.0, 9.0 };
+    quality = std::min((int)QUALITY_HIGH, std::max((int)QUALITY_LOW, quality));
+    srate  = sr;
+    factor = std::min((int)max_factor, std::max(1, fctr));
+    taps   = quality_taps[quality];
+    int len = factor * taps;
+    double center = (len - 1) * 0.5;
+    double fc = quality_cutoff[quality] * 0.5 / factor; // normalized to the oversampled rate
+    double h[max_factor * max_taps];
+    double sum = 0;
+    for (int i = 0; i < len; i++) {
+        double x = i - center;
+        double s = x == 0 ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x);
+        double r = x / (center + 0.5);
+        h[i] = s * bessel_i0(quality_beta[quality] * sqrt(std::max(0., 1 - r * r))) / bessel_i0(quality_beta[quality]);
+        sum += h[i];
     }
+    // unity gain at DC for downsampling, factor for each upsampling phase
+    for (int i = 0; i < len; i++)
+        down_coeffs[i] = h[i] / sum;
+    phase_stride = (factor + 3) & ~3;
+    memset(up_coeffs, 0, sizeof(up_coeffs));
+    for (int k = 0; k < taps; k++)
+        for (int p = 0; p < factor; p++)
+            up_coeffs[k * phase_stride + p] = factor * h[p + (taps - 1 - k) * factor] / sum;
+    reset();
 }
-double *resampleN::upsample(double sample)
+
+void oversampler::reset()
+{
+    memset(up_hist, 0, sizeof(up_hist));
+    memset(down_hist, 0, sizeof(down_hist));
+    memset(tmp, 0, sizeof(tmp));
+    up_pos = 0;
+    down_pos = 0;
+}
+
+float *oversampler::upsample(float sample)
 {
-    tmp[0] = sample;
-    if (factor > 1) {
-        for (int f = 0; f < filters; f++)
-            tmp[0] = filter[0][f].process(sample);
-        for (int i = 1; i < factor; i++) {
-            tmp[i] = 0;
-            for (int f = 0; f < filters; f++)
-                tmp[i] = filter[0][f].process(sample);
+    if (factor == 1) {
+        tmp[0] = sample;
+        return tmp;
+    }
+    up_hist[up_pos] = up_hist[up_pos + taps] = sample;
+    if (++up_pos == taps)
+        up_pos = 0;
+    // oldest to newest input sample; all phases are computed side by side,
+    // one input sample at a time
+    const float *x = up_hist + up_pos;
+    for (int p = 0; p < phase_stride; p += 4) {
+        const float *c = up_coeffs + p;
+#if defined(__SSE__)
+        __m128 acc = _mm_setzero_ps(), acc2 = _mm_setzero_ps();
+        for (int k = 0; k < taps; k += 2, c += 2 * phase_stride) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(c), _mm_set1_ps(x[k])));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(c + phase_stride), _mm_set1_ps(x[k + 1])));
+        }
+        _mm_storeu_ps(tmp + p, _mm_add_ps(acc, acc2));
+#else
+        float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+        for (int k = 0; k < taps; k++, c += phase_stride) {
+            s0 += c[0] * x[k];
+            s1 += c[1] * x[k];
+            s2 += c[2] * x[k];
+            s3 += c[3] * x[k];
         }
+        tmp[p] = s0;
+        tmp[p + 1] = s1;
+        tmp[p + 2] = s2;
+        tmp[p + 3] = s3;
+#endif
     }
     return tmp;
 }
-double resampleN::downsample(double *sample)
+
+float oversampler::downsample(const float *samples)
 {
-    if (factor > 1) {
-        for(int i = 0; i < factor; i++) {
-            for (int f = 0; f < filters; f++) {
-                sample[i] = filter[1][f].process(sample[i]);
-            }
-        }
+    if (factor == 1)
+        return samples[0];
+    int len = factor * taps;
+    for (int i = 0; i < factor; i++) {
+        down_hist[down_pos] = down_hist[down_pos + len] = samples[i];
+        if (++down_pos == len)
+            down_pos = 0;
+    }
+    return dot8(down_coeffs, down_hist + down_pos, len);
+}
+
+void oversampler::upsample(const float *in, float *out, uint32_t numsamples)
+{
+    for (uint32_t i = 0; i < numsamples; i++, out += factor) {
+        const float *s = upsample(in[i]);
+        for (int p = 0; p < factor; p++)
+            out[p] = s[p];
     }
-    return sample[0];
+}
+
+void oversampler::downsample(const float *in, float *out, uint32_t numsamples)
+{
+    for (uint32_t i = 0; i < numsamples; i++, in += factor)
+        out[i] = downsample(in);
 }
 
 //////////////////////////////////////////////////////////////////
@@ -25,9 +25,14 @@
 #include <calf/modules_tools.h>
 #include <calf/modules_delay.h>
 #include <calf/modules_comp.h>
+#include <calf/modules_limit.h>
 #include <calf/modules_dev.h>
+#include <calf/modules_dist.h>
 #include <calf/modules_filter.h>
 #include <calf/modules_mod.h>
+#include <calf/modules_pitch.h>
+#include <calf/modules_synths.h>
+#include <calf/organ.h>
 #else
 #include <config.h>
 #endif
@@ -218,11 +223,15 @@ struct __attribute__((aligned(8))) misaligned_double: public alignment_test
 };
 
 const char *unit = NULL;
+unsigned int block_size = 256;
+float deadline_share = 10;
 
 static struct option long_options[] = {
     {"help", 0, 0, 'h'},
     {"version", 0, 0, 'v'},
     {"unit", 1, 0, 'u'},
+    {"blocksize", 1, 0, 'b'},
+    {"deadline", 1, 0, 'd'},
     {0,0,0,0},
 };
 
@@ -368,11 +377,314 @@ void effect_test()
     dsp::do_simple_benchmark<effect_benchmark<calf_plugins::multichorus_audio_module> >(5, 10000);
 }
 
+/// Runs any plugin through process_slice, with all parameters at their metadata defaults
+struct plugin_benchmark
+{
+    calf_plugins::audio_module_iface *module;
+    const calf_plugins::plugin_metadata_iface *metadata;
+    uint32_t srate, bufsize;
+    bool is_synth, activated;
+    std::vector<float> inputs, outputs, params;
+    float result;
+
+    plugin_benchmark(calf_plugins::audio_module_iface *_module, bool _is_synth, uint32_t _bufsize)
+    : module(_module)
+    , metadata(_module->get_metadata_iface())
+    , srate(44100)
+    , bufsize(_bufsize)
+    , is_synth(_is_synth)
+    , activated(false)
+    , inputs(metadata->get_input_count() * _bufsize)
+    , outputs(metadata->get_output_count() * _bufsize)
+    , params(metadata->get_param_count())
+    , result(0.f)
+    {
+        for (int i = 0; i < metadata->get_param_count(); i++)
+            params[i] = metadata->get_param_props(i)->def_value;
+    }
+    void prepare()
+    {
+        float **ins, **outs, **pars;
+        module->get_port_arrays(ins, outs, pars);
+        for (int b = 0; b < metadata->get_input_count(); b++)
+        {
+            ins[b] = &inputs[b * bufsize];
+            for (unsigned int i = 0; i < bufsize; i++)
+                ins[b][i] = 0.25f * sin(i * (0.05f + 0.01f * b)) + 0.125f * sin(i * 0.31f);
+        }
+        for (int b = 0; b < metadata->get_output_count(); b++)
+            outs[b] = &outputs[b * bufsize];
+        for (int i = 0; i < metadata->get_param_count(); i++)
+            pars[i] = &params[i];
+        if (!activated)
+        {
+            module->post_instantiate(srate);
+            module->set_sample_rate(srate);
+            module->activate();
+            module->params_changed();
+            // synths are silent without notes, so hold a chord for the whole measurement
+            if (is_synth)
+            {
+                module->note_on(0, 60, 100);
+                module->note_on(0, 64, 100);
+                module->note_on(0, 67, 100);
+            }
+            activated = true;
+        }
+        result = 0.f;
+    }
+    void run()
+    {
+        module->process_slice(0, bufsize);
+    }
+    void cleanup()
+    {
+        for (size_t i = 0; i < outputs.size(); i++)
+            result += fabs(outputs[i]);
+    }
+    double scaler() { return bufsize; }
+};
+
+struct plugin_benchmark_result
+{
+    std::string name;
+    double ns_per_sample;
+    bool operator<(const plugin_benchmark_result &other) const { return ns_per_sample > other.ns_per_sample; }
+};
+
+static void print_plugin_benchmark(const char *name, double ns_per_sample, unsigned int bufsize)
+{
+    printf("%-22s %6u %12.2f %9.3f%% %9.3f%% %9.3f%%\n", name, bufsize, ns_per_sample,
+        ns_per_sample * 44100e-7, ns_per_sample * 48000e-7, ns_per_sample * 96000e-7);
+}
+
+static void run_plugin_benchmark(calf_plugins::audio_module_iface *module, const char *name, bool is_synth, std::vector<plugin_benchmark_result> &results)
+{
+    dsp::median_stat stat;
+    dsp::simple_benchmark<plugin_benchmark, dsp::median_stat> benchmark(plugin_benchmark(module, is_synth, block_size), stat);
+    // roughly 12 seconds of audio per run, regardless of block size
+    benchmark.measure(5, std::max(1u, 524288 / block_size));
+    module->deactivate();
+    delete module;
+
+    plugin_benchmark_result res;
+    res.name = name;
+    res.ns_per_sample = stat.get() * 1e9;
+    results.push_back(res);
+    print_plugin_benchmark(name, res.ns_per_sample, block_size);
+    fflush(stdout);
+}
+
+void all_plugins_test()
+{
+    using namespace calf_plugins;
+    std::vector<plugin_benchmark_result> results;
+    printf("%-22s %6s %12s %10s %10s %10s\n", "plugin", "block", "ns/sample", "CPU@44.1k", "CPU@48k", "CPU@96k");
+    #define PER_MODULE_ITEM(name, isSynth, jackname) run_plugin_benchmark(new name##_audio_module, jackname, isSynth, results);
+    #include <calf/modulelist.h>
+
+    std::sort(results.begin(), results.end());
+    printf("\nRanked by cost per sample:\n");
+    double total = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        print_plugin_benchmark(results[i].name.c_str(), results[i].ns_per_sample, block_size);
+        total += results[i].ns_per_sample;
+    }
+    print_plugin_benchmark("(all plugins)", total, block_size);
+}
+
+static void run_latency_benchmark(calf_plugins::audio_module_iface *module, const char *name, bool is_synth, std::vector<std::string> &flagged)
+{
+    // histogram buckets, as percentage of the block deadline
+    static const double limits_pct[] = { 1, 2, 5, 10, 25, 50, 100 };
+    enum { nlimits = sizeof(limits_pct) / sizeof(limits_pct[0]) };
+    double deadline = block_size / 44100.0;
+    double limits[nlimits];
+    unsigned int buckets[nlimits + 1];
+    for (int i = 0; i < nlimits; i++)
+        limits[i] = limits_pct[i] * 0.01 * deadline;
+
+    dsp::percentile_stat stat;
+    dsp::per_call_benchmark<plugin_benchmark, dsp::percentile_stat> benchmark(plugin_benchmark(module, is_synth, block_size), stat);
+    // 10 seconds of audio
+    benchmark.measure(std::max(1u, 441000 / block_size));
+    module->deactivate();
+    delete module;
+
+    double worst = stat.get_max() * 100.0 / deadline;
+    bool over = worst > deadline_share;
+    printf("%-22s %6u %9.2f %9.2f %9.2f %9.2f %8.2f%% %s\n", name, block_size, stat.get() * 1e6, stat.get_percentile(99) * 1e6, stat.get_percentile(99.9) * 1e6, stat.get_max() * 1e6, worst, over ? "!!" : "");
+    stat.get_histogram(limits, nlimits, buckets);
+    printf("%-29s", "");
+    for (int i = 0; i < nlimits; i++)
+        printf(" <%g%%:%u", limits_pct[i], buckets[i]);
+    printf(" >100%%:%u\n", buckets[nlimits]);
+    fflush(stdout);
+    if (over)
+        flagged.push_back(name);
+}
+
+void latency_test()
+{
+    using namespace calf_plugins;
+    std::vector<std::string> flagged;
+    printf("Per-call process_slice time in microseconds, block deadline %.2f us\n", block_size * 1e6 / 44100.0);
+    printf("%-22s %6s %9s %9s %9s %9s %9s\n", "plugin", "block", "p50", "p99", "p99.9", "max", "max/dl");
+    #define PER_MODULE_ITEM(name, isSynth, jackname) run_latency_benchmark(new name##_audio_module, jackname, isSynth, flagged);
+    #include <calf/modulelist.h>
+
+    if (!flagged.empty())
+    {
+        printf("\nWorst case above %g%% of the block deadline:", deadline_share);
+        for (size_t i = 0; i < flagged.size(); i++)
+            printf(" %s", flagged[i].c_str());
+        printf("\n");
+    }
+}
+
+/// Feeds a plugin the decaying tail of a signal - noise in the denormal range -
+/// straight through process(), so that neither the silence skip nor the denormal
+/// mode of process_slice is involved, optionally with FTZ/DAZ switched on
+struct tail_benchmark: public plugin_benchmark
+{
+    bool flush;
+
+    tail_benchmark(calf_plugins::audio_module_iface *_module, uint32_t _bufsize)
+    : plugin_benchmark(_module, false, _bufsize)
+    , flush(false)
+    {
+    }
+    void prepare()
+    {
+        plugin_benchmark::prepare();
+        unsigned int seed = 1;
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            inputs[i] = ((int)(seed >> 16 & 0x7FFF) - 16384) * (1e-38f / 16384);
+        }
+    }
+    void run_slices()
+    {
+        for (uint32_t offset = 0; offset < bufsize; offset += calf_plugins::MAX_SAMPLE_RUN)
+            module->process(offset, std::min<uint32_t>(calf_plugins::MAX_SAMPLE_RUN, bufsize - offset), -1, -1);
+    }
+    void run()
+    {
+        if (flush)
+        {
+            dsp::denormal_guard denormals;
+            run_slices();
+        }
+        else
+            run_slices();
+    }
+};
+
+static void run_denormal_benchmark(calf_plugins::audio_module_iface *module, const char *name, bool is_synth)
+{
+    // synths have no input to decay
+    if (!is_synth)
+    {
+        dsp::median_stat plain_stat, flushed_stat;
+        dsp::simple_benchmark<tail_benchmark, dsp::median_stat> plain(tail_benchmark(module, block_size), plain_stat);
+        plain.measure(5, std::max(1u, 131072 / block_size));
+        // same (already activated) module, FTZ/DAZ on
+        dsp::simple_benchmark<tail_benchmark, dsp::median_stat> flushed(plain.target, flushed_stat);
+        flushed.target.flush = true;
+        flushed.measure(5, std::max(1u, 131072 / block_size));
+        double plain_ns = plain_stat.get() * 1e9, flushed_ns = flushed_stat.get() * 1e9;
+        printf("%-22s %6u %12.2f %12.2f %8.2fx\n", name, block_size, plain_ns, flushed_ns, plain_ns / flushed_ns);
+        fflush(stdout);
+    }
+    module->deactivate();
+    delete module;
+}
+
+void denormal_test()
+{
+    using namespace calf_plugins;
+    printf("Denormal tail input, ns/sample; per-sample sanitize %s\n", CALF_SAMPLE_SANITIZE ? "compiled in" : "compiled out");
+    printf("%-22s %6s %12s %12s %9s\n", "plugin", "block", "no FTZ/DAZ", "FTZ/DAZ", "ratio");
+    #define PER_MODULE_ITEM(name, isSynth, jackname) run_denormal_benchmark(new name##_audio_module, jackname, isSynth);
+    #include <calf/modulelist.h>
+}
+
+/// Holds a chord of the given size on the organ, with all other parameters at their defaults
+/// except for the vibrato mode, to show how the cost grows with polyphony
+struct organ_benchmark: public plugin_benchmark
+{
+    int voices;
+
+    organ_benchmark(int _voices, int vibrato_mode, uint32_t _bufsize)
+    : plugin_benchmark(new calf_plugins::organ_audio_module, false, _bufsize)
+    , voices(_voices)
+    {
+        params[calf_plugins::organ_audio_module::par_polyphony] = voices;
+        params[calf_plugins::organ_audio_module::par_lfomode] = vibrato_mode;
+    }
+    void prepare()
+    {
+        bool first = !activated;
+        plugin_benchmark::prepare();
+        if (first)
+        {
+            for (int i = 0; i < voices; i++)
+                module->note_on(0, 36 + 2 * i, 100);
+        }
+    }
+};
+
+static double run_organ_benchmark(int voices, int vibrato_mode)
+{
+    dsp::median_stat stat;
+    dsp::simple_benchmark<organ_benchmark, dsp::median_stat> benchmark(organ_benchmark(voices, vibrato_mode, block_size), stat);
+    benchmark.measure(5, std::max(1u, 131072 / block_size));
+    benchmark.target.module->deactivate();
+    delete benchmark.target.module;
+    return stat.get() * 1e9;
+}
+
+void organ_test()
+{
+    static const int voices[] = { 1, 4, 8, 16, 32 };
+    printf("Organ with a held chord, ns/sample (per voice in brackets)\n");
+    printf("%6s %6s %22s %22s %10s\n", "voices", "block", "no vibrato", "per-voice vibrato", "CPU@44.1k");
+    for (unsigned int i = 0; i < sizeof(voices) / sizeof(voices[0]); i++)
+    {
+        double plain = run_organ_benchmark(voices[i], calf_plugins::organ_enums::lfomode_off);
+        double vibrato = run_organ_benchmark(voices[i], calf_plugins::organ_enums::lfomode_voice);
+        printf("%6d %6u %12.2f (%7.2f) %12.2f (%7.2f) %9.3f%%\n", voices[i], block_size, plain, plain / voices[i], vibrato, vibrato / voices[i], vibrato * 44100e-7);
+        fflush(stdout);
+    }
+}
+
 #else
 void effect_test()
 {
     printf("Test temporarily removed due to refactoring\n");
 }
+
+void all_plugins_test()
+{
+    printf("Test requires BENCHMARK_PLUGINS\n");
+}
+
+void latency_test()
+{
+    printf("Test requires BENCHMARK_PLUGINS\n");
+}
+
+void denormal_test()
+{
+    printf("Test requires BENCHMARK_PLUGINS\n");
+}
+
+void organ_test()
+{
+    printf("Test requires BENCHMARK_PLUGINS\n");
+}
 #endif
 void reverbir_calc()
 {
@@ -498,13 +810,13 @@ int main(int argc, char *argv[])
 {
     while(1) {
         int option_index;
-        int c = getopt_long(argc, argv, "u:hv", long_options, &option_index);
+        int c = getopt_long(argc, argv, "u:b:d:hv", long_options, &option_index);
         if (c == -1)
             break;
         switch(c) {
             case 'h':
             case '?':
-                printf("Benchmark suite Calf plugin pack\nSyntax: %s [--help] [--version] [--unit biquad|alignment|effects]\n", argv[0]);
+                printf("Benchmark suite Calf plugin pack\nSyntax: %s [--help] [--version] [--unit biquad|alignment|effects|allplugins|latency|denormals|organ] [--blocksize N] [--deadline percent]\n", argv[0]);
                 return 0;
             case 'v':
                 printf("%s\n", PACKAGE_STRING);
@@ -512,6 +824,12 @@ int main(int argc, char *argv[])
             case 'u':
                 unit = optarg;
                 break;
+            case 'b':
+                block_size = std::max(1, atoi(optarg));
+                break;
+            case 'd':
+                deadline_share = atof(optarg);
+                break;
         }
     }
     
@@ -529,6 +847,17 @@ int main(int argc, char *argv[])
     if (!unit || !strcmp(unit, "effects"))
         effect_test();
 
+    if (unit && !strcmp(unit, "allplugins"))
+        all_plugins_test();
+
+    if (unit && !strcmp(unit, "latency"))
+        latency_test();
+
+    if (unit && !strcmp(unit, "denormals"))
+        denormal_test();
+    if (unit && !strcmp(unit, "organ"))
+        organ_test();
+
     if (unit && !strcmp(unit, "reverbir"))
         reverbir_calc();
 
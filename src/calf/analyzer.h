@@ -37,6 +37,8 @@
 
 namespace calf_plugins {
 
+struct analyzer_worker;
+
 class analyzer: public frequency_response_line_graph
 {
 private:
@@ -60,13 +62,36 @@ private:
 public:
     uint32_t srate;
     analyzer();
-    void process(float L, float R);
+    /// Feed a pair of samples; does nothing while no GUI is displaying the analyzer
+    inline void process(float L, float R) {
+        float *buffer = feed;
+        if (!buffer)
+            return;
+        int pos = (fed & (ring_pairs - 1)) * 2;
+        buffer[pos] = L;
+        buffer[pos + 1] = R;
+        // let the FFT worker see the new samples every now and then
+        if (!(++fed & (publish_interval - 1))) {
+            __sync_synchronize();
+            written = fed;
+        }
+        // nobody looked at the results for a while - stop feeding, so that
+        // the GUI thread can give the buffers back
+        if (++idle_samples > idle_timeout)
+            feed = NULL;
+    }
+    /// Allocate the buffers (if needed) and start feeding them; GUI thread only
+    void wake() const;
+    /// Free the buffers if the audio thread stopped feeding them; GUI thread only
+    void release_idle() const;
     void set_sample_rate(uint32_t sr);
     bool set_mode(int mode);
     void invalidate();
     void set_params(float resolution, float offset, int accuracy, int hold, int smoothing, int mode, int scale, int post, int speed, int windowing, int view, int freeze);
     ~analyzer();
     bool do_fft(int subindex, int points) const;
+    /// Compute a new spectrum if the GUI asked for one; FFT worker thread only
+    void run_fft() const;
     void draw(int subindex, float *data, int points, bool fftdone) const;
     bool get_graph(int subindex, int phase, float *data, int points, cairo_iface *context, int *mode) const;
     bool get_moving(int subindex, int &direction, float *data, int x, int y, int &offset, uint32_t &color) const;
@@ -74,21 +99,47 @@ public:
     bool get_layers(int generation, unsigned int &layers) const;
 protected:
     int fft_buffer_size;
-    float *fft_buffer;
-    int *spline_buffer;
-    int fpos;
+    /// Ring buffer of interleaved L/R sample pairs written by the audio thread
+    mutable float *fft_buffer;
+    mutable int *spline_buffer;
+    /// fft_buffer while the audio thread is feeding it, NULL while dormant
+    mutable float *volatile feed;
+    /// Samples fed since the GUI last asked for a graph
+    mutable volatile uint32_t idle_samples;
+    uint32_t idle_timeout;
+    /// Sample pairs written so far (audio thread only)
+    mutable uint32_t fed;
+    /// Sample pairs the FFT worker may read, updated every publish_interval pairs
+    mutable volatile uint32_t written;
     mutable bool sanitize, recreate_plan;
     static const int MAX_FFT_ORDER = 15;
     dsp::fft<float, MAX_FFT_ORDER> fft;
-    mutable dsp::fft<float, MAX_FFT_ORDER>::complex fft_temp[1 << MAX_FFT_ORDER];
+    mutable dsp::fft<float, MAX_FFT_ORDER>::complex *fft_temp;
     static const int max_fft_cache_size = 32768;
-    static const int max_fft_buffer_size = max_fft_cache_size * 2;
-    float *fft_inL, *fft_outL;
-    float *fft_inR, *fft_outR;
-    float *fft_smoothL, *fft_smoothR;
-    float *fft_deltaL, *fft_deltaR;
-    float *fft_holdL, *fft_holdR;
-    float *fft_freezeL, *fft_freezeR;
+    /// The longest FFT plus as much again for the audio thread to run ahead while a snapshot is read
+    static const int ring_pairs = max_fft_cache_size * 2;
+    static const uint32_t publish_interval = 32;
+    /// Windowed input of the FFT (worker thread)
+    mutable float *fft_inL, *fft_inR;
+    /// Triple buffer of L/R spectra between the worker and the GUI: the
+    /// worker fills the back one, the GUI draws from the front one, and
+    /// they exchange them through the middle one
+    mutable float *spectrum[3][2];
+    mutable int spectrum_front, spectrum_back;
+    mutable volatile int spectrum_middle;
+    /// Set in spectrum_middle when it holds a spectrum the GUI hasn't picked up yet
+    static const int spectrum_fresh = 4;
+    mutable volatile int fft_request, fft_points;
+    /// FFT order, mode and windowing for the worker, packed into one word (see pack_fft_params)
+    /// so that it never sees a mix of old and new values; -1 until set_params was called
+    mutable volatile int fft_params;
+    /// Front spectrum (GUI thread)
+    mutable float *fft_outL, *fft_outR;
+    mutable float *fft_smoothL, *fft_smoothR;
+    mutable float *fft_deltaL, *fft_deltaR;
+    mutable float *fft_holdL, *fft_holdR;
+    mutable float *fft_freezeL, *fft_freezeR;
+    void free_buffers() const;
     mutable int lintrans;
     mutable int analyzer_phase_drawn;
 };
@@ -576,8 +576,11 @@ public:
     bool use_multi;
     unsigned int id;
     bool _sanitize;
+    // queue of positions to walk to and the deltas to follow from there,
+    // nextiter is the head, the slopes grow from head to tail
     int nextiter;
     int nextlen;
+    int next_mask;
     int * nextpos;
     float * nextdelta;
     int asc_c;
@@ -587,10 +590,14 @@ public:
     float asc_coeff;
     bool _asc_used;
     static inline void denormal(volatile float *f) {
+#if CALF_SAMPLE_SANITIZE
         *f += 1e-18;
         *f -= 1e-18;
+#endif
     }
     inline float get_rdelta(float peak, float _limit, float _att, bool _asc = true);
+    inline float get_gain(int p, const float *multi_buffer) const;
+    inline float get_walk_delta(int p, float gain, const float *multi_buffer) const;
     void reset();
     void reset_asc();
     bool get_asc();
@@ -598,6 +605,8 @@ public:
     ~lookahead_limiter();
     void set_multi(bool set);
     void process(float &left, float &right, float *multi_buffer);
+    /// Limit numsamples samples of separate left/right buffers in place
+    void process_block(float *left, float *right, float *multi_buffer, uint32_t numsamples);
     void set_sample_rate(uint32_t sr);
     void set_params(float l, float a, float r, float weight = 1.f, bool ar = false, float arc = 1.f, bool d = false);
     float get_attenuation();
@@ -640,6 +649,8 @@ public:
     uint32_t srate;
     crossover();
     void process(float *data);
+    /// Split numsamples of each channel in data into outs[band * channels + channel]
+    void process_block(float * const *data, float * const *outs, uint32_t numsamples);
     float get_value(int c, int b);
     void set_sample_rate(uint32_t sr);
     float set_filter(int b, float f, bool force = false);
@@ -672,20 +683,52 @@ public:
     bool get_gridline(int subindex, int phase, float &pos, bool &vertical, std::string &legend, calf_plugins::cairo_iface *context) const;
 };
 
-class resampleN
+/// Polyphase FIR oversampler. Upsampling runs a windowed sinc lowpass as
+/// factor interleaved subfilters of taps coefficients each, so the stuffed zeros
+/// are never multiplied; downsampling evaluates the same lowpass only once per
+/// output sample. Both directions keep their own history, so one instance can
+/// upsample a signal and downsample another.
+class oversampler
 {
-private:
 public:
+    enum { max_factor = 16, max_taps = 48 };
+    /// Quality presets - more taps per phase give a steeper lowpass, better
+    /// alias rejection and more latency
+    enum quality_t { QUALITY_LOW, QUALITY_MEDIUM, QUALITY_HIGH };
+private:
     uint32_t srate; // sample rate; source for upsampling, target for downsampling
-    int factor; // number of added/removed samples, max 16
-    int filters; // how many lowpasses should be used, max 4
-    double tmp[16];
-    dsp::biquad_d2 filter[2][4];
-    resampleN();
-    ~resampleN();
-    void set_params(uint32_t sr, int factor, int filters);
-    double *upsample(double sample);
-    double downsample(double *sample);
+    int factor; // oversampling factor, max 16
+    int taps; // taps per phase, multiple of 8
+    int phase_stride; // factor rounded up to a multiple of 4
+    /// Upsampling phases interleaved, up_coeffs[k * phase_stride + p] is h[p + (taps - 1 - k) * factor] * factor
+    float up_coeffs[max_factor * max_taps];
+    /// Full prototype lowpass for downsampling (symmetric, so no reversal needed)
+    float down_coeffs[max_factor * max_taps];
+    /// Input history, stored twice so that the last taps samples are always contiguous
+    float up_hist[2 * max_taps];
+    /// Oversampled history for downsampling, stored twice as well
+    float down_hist[2 * max_factor * max_taps];
+    int up_pos, down_pos;
+    float tmp[max_factor];
+public:
+    oversampler();
+    /// Set the base sample rate, the oversampling factor and the filter quality (clears the state)
+    void set_params(uint32_t sr, int factor, int quality = QUALITY_MEDIUM);
+    int get_factor() const { return factor; }
+    /// Delay of an upsample/downsample round trip in base rate samples. The
+    /// prototype lowpass delays by (factor * taps - 1) / 2 oversampled samples
+    /// in each direction, and downsampling takes the last of each group of
+    /// factor samples, so the round trip is exactly taps - 1 base rate samples.
+    int get_latency() const { return factor > 1 ? taps - 1 : 0; }
+    void reset();
+    /// Upsample one sample, returns factor samples (valid until the next call)
+    float *upsample(float sample);
+    /// Downsample factor samples to one
+    float downsample(const float *samples);
+    /// Upsample numsamples samples into numsamples * factor samples
+    void upsample(const float *in, float *out, uint32_t numsamples);
+    /// Downsample numsamples * factor samples into numsamples samples
+    void downsample(const float *in, float *out, uint32_t numsamples);
 };
 
 class samplereduction
@@ -711,7 +754,7 @@ private:
     float rdrive, rbdr, kpa, kpb, kna, knb, ap, an, imr, kc, srct, sq, pwrq;
     int over;
     float prev_med, prev_out;
-    resampleN resampler;
+    oversampler resampler;
 public:
     uint32_t srate;
     bool is_active;
@@ -722,6 +765,8 @@ public:
     void set_sample_rate(uint32_t sr);
     float process(float in);
     float get_distortion_level();
+    /// Delay of the processed signal in samples, a dry signal mixed with it must be delayed as much
+    int get_latency() const { return resampler.get_latency(); }
     static inline float M(float x)
     {
         return (fabs(x) > 0.00000001f) ? x : 0.0f;
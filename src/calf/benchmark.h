@@ -73,6 +73,37 @@ public:
     }
 };
 
+/// Keeps all the values, for percentiles and worst case
+class percentile_stat: public median_stat
+{
+public:
+    /// @param pct percentile, 0 to 100
+    float get_percentile(double pct)
+    {
+        assert(sorted);
+        unsigned int idx = (unsigned int)(pct * 0.01 * count);
+        return data[std::min(idx, count - 1)];
+    }
+    float get_max()
+    {
+        assert(sorted);
+        return data[count - 1];
+    }
+    /// Count values below each of nlimits ascending limits, buckets[nlimits] receives the rest
+    void get_histogram(const double *limits, unsigned int nlimits, unsigned int *buckets)
+    {
+        assert(sorted);
+        unsigned int pos = 0;
+        for (unsigned int i = 0; i < nlimits; i++)
+        {
+            unsigned int end = std::lower_bound(&data[pos], &data[count], limits[i]) - &data[0];
+            buckets[i] = end - pos;
+            pos = end;
+        }
+        buckets[nlimits] = count - pos;
+    }
+};
+
 // USE_RDTSC is for testing on my own machine, a crappy 1.6GHz Pentium 4 - it gives less headaches than clock() based measurements
 #define USE_RDTSC 0
 #define CLOCK_SPEED (1.6 * 1000.0 * 1000.0 * 1000.0)
@@ -146,6 +177,52 @@ public:
     }
 };
 
+/// Wall clock time in seconds, monotonic
+inline double get_monotonic_time()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// Times every call of target.run() separately - averages hide the occasional expensive call
+template<typename Target, class Stat>
+class per_call_benchmark: public benchmark_globals
+{
+public:
+    Target target;
+    Stat &stat;
+
+    per_call_benchmark(const Target &_target, Stat &_stat)
+    : target(_target)
+    , stat(_stat)
+    {
+    }
+
+    void measure(int calls, int warmup = 16)
+    {
+        int priority = getpriority(PRIO_PROCESS, getpid());
+        stat.start(calls);
+        if (setpriority(PRIO_PROCESS, getpid(), -20) < 0) {
+            if (!warned) {
+                fprintf(stderr, "Warning: could not set process priority, measurements can be worthless\n");
+                warned = true;
+            }
+        }
+        target.prepare();
+        for (int i = 0; i < warmup; i++)
+            target.run();
+        for (int i = 0; i < calls; i++) {
+            double start = get_monotonic_time();
+            target.run();
+            stat.add(get_monotonic_time() - start);
+        }
+        target.cleanup();
+        setpriority(PRIO_PROCESS, getpid(), priority);
+        stat.end();
+    }
+};
+
 template<class T>
 void do_simple_benchmark(int runs = 5, int repeats = 50000)
 {
@@ -25,6 +25,9 @@
 
 #include <complex>
 #include "primitives.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace dsp {
 
@@ -393,6 +396,23 @@ struct biquad_d1: public biquad_coeffs
         y1 = out;
         return out;
     }
+    /// direct I form for a whole block (in and out may point to the same buffer), state is sanitized once at the end
+    inline void process_block(const float *in, float *out, uint32_t numsamples)
+    {
+        double lx1 = x1, lx2 = x2, ly1 = y1, ly2 = y2;
+        for (uint32_t i = 0; i < numsamples; i++)
+        {
+            double xin = in[i];
+            double yout = xin * a0 + lx1 * a1 + lx2 * a2 - ly1 * b1 - ly2 * b2;
+            lx2 = lx1;
+            ly2 = ly1;
+            lx1 = xin;
+            ly1 = yout;
+            out[i] = yout;
+        }
+        x1 = lx1; x2 = lx2; y1 = ly1; y2 = ly2;
+        sanitize();
+    }
     /// Sanitize (set to 0 if potentially denormal) filter state
     inline void sanitize() 
     {
@@ -437,10 +457,12 @@ struct biquad_d2: public biquad_coeffs
     inline double process(double in)
     {
         double n = in;
+#if CALF_SAMPLE_SANITIZE
         dsp::sanitize_denormal(n);
         dsp::sanitize(n);
         dsp::sanitize(w1);
         dsp::sanitize(w2);
+#endif
 
         double tmp = n - w1 * b1 - w2 * b2;
         double out = tmp * a0 + w1 * a1 + w2 * a2;
@@ -449,6 +471,22 @@ struct biquad_d2: public biquad_coeffs
         return out;
     }
     
+    /// direct II form for a whole block (in and out may point to the same buffer), state is sanitized once at the end
+    inline void process_block(const float *in, float *out, uint32_t numsamples)
+    {
+        double lw1 = w1, lw2 = w2;
+        for (uint32_t i = 0; i < numsamples; i++)
+        {
+            double tmp = in[i] - lw1 * b1 - lw2 * b2;
+            out[i] = tmp * a0 + lw1 * a1 + lw2 * a2;
+            lw2 = lw1;
+            lw1 = tmp;
+        }
+        w1 = lw1;
+        w2 = lw2;
+        sanitize();
+    }
+    
     // direct II form with two state variables, lowpass version
     // interesting fact: this is actually slower than the general version!
     inline double process_lp(double in)
@@ -481,6 +519,119 @@ struct biquad_d2: public biquad_coeffs
     }
 };
 
+/// Run a block through count filters in series, one stage at a time (in and out may point to the same buffer)
+template<class Biquad>
+inline void process_block_cascade(Biquad *stages, int count, const float *in, float *out, uint32_t numsamples)
+{
+    if (!count)
+    {
+        if (in != out)
+            std::copy(in, in + numsamples, out);
+        return;
+    }
+    stages[0].process_block(in, out, numsamples);
+    for (int i = 1; i < count; i++)
+        stages[i].process_block(out, out, numsamples);
+}
+
+/// Filter a stereo pair of blocks; right must have the same coefficients as left (only the state of right is used)
+inline void process_block_stereo(biquad_d2 &left, biquad_d2 &right, const float *inL, const float *inR, float *outL, float *outR, uint32_t numsamples)
+{
+#if defined(__SSE2__)
+    // both channels in one register - the recursion stays serial, but the channels run side by side
+    __m128d a0 = _mm_set1_pd(left.a0), a1 = _mm_set1_pd(left.a1), a2 = _mm_set1_pd(left.a2);
+    __m128d b1 = _mm_set1_pd(left.b1), b2 = _mm_set1_pd(left.b2);
+    __m128d w1 = _mm_set_pd(right.w1, left.w1), w2 = _mm_set_pd(right.w2, left.w2);
+    for (uint32_t i = 0; i < numsamples; i++)
+    {
+        __m128d in = _mm_set_pd(inR[i], inL[i]);
+        __m128d tmp = _mm_sub_pd(in, _mm_add_pd(_mm_mul_pd(w1, b1), _mm_mul_pd(w2, b2)));
+        __m128d out = _mm_add_pd(_mm_mul_pd(tmp, a0), _mm_add_pd(_mm_mul_pd(w1, a1), _mm_mul_pd(w2, a2)));
+        w2 = w1;
+        w1 = tmp;
+        outL[i] = _mm_cvtsd_f64(out);
+        outR[i] = _mm_cvtsd_f64(_mm_unpackhi_pd(out, out));
+    }
+    _mm_storel_pd(&left.w1, w1);
+    _mm_storeh_pd(&right.w1, w1);
+    _mm_storel_pd(&left.w2, w2);
+    _mm_storeh_pd(&right.w2, w2);
+    left.sanitize();
+    right.sanitize();
+#else
+    left.process_block(inL, outL, numsamples);
+    right.process_block(inR, outR, numsamples);
+#endif
+}
+
+/**
+ * A bank of MaxBands filters, MaxStages direct II form biquads in series each.
+ * Coefficients and state are kept in per-band arrays (structure of arrays), so
+ * a stage of neighbouring bands is computed a vector at a time.
+ * All stages of a band share the same coefficients. MaxBands must be a multiple of 4.
+ */
+template<int MaxBands, int MaxStages>
+struct biquad_d2_bank
+{
+    double a0[MaxBands], a1[MaxBands], a2[MaxBands], b1[MaxBands], b2[MaxBands];
+    double w1[MaxStages][MaxBands], w2[MaxStages][MaxBands];
+    
+    biquad_d2_bank()
+    {
+        for (int i = 0; i < MaxBands; i++)
+            set_coeffs(i, biquad_coeffs());
+        reset();
+    }
+    inline void set_coeffs(int band, const biquad_coeffs &c)
+    {
+        a0[band] = c.a0;
+        a1[band] = c.a1;
+        a2[band] = c.a2;
+        b1[band] = c.b1;
+        b2[band] = c.b2;
+    }
+    /// Number of bands actually computed for a given number of used bands
+    static inline int padded(int bands)
+    {
+        return (bands + 3) & ~3;
+    }
+    /// Run one sample of the first bands bands through a single stage (in and out may be the same array, both at least padded(bands) long)
+    inline void process_stage(int stage, const double *in, double *out, int bands)
+    {
+        double *s1 = w1[stage], *s2 = w2[stage];
+        bands = padded(bands);
+        for (int i = 0; i < bands; i++)
+        {
+            double tmp = in[i] - s1[i] * b1[i] - s2[i] * b2[i];
+            out[i] = tmp * a0[i] + s1[i] * a1[i] + s2[i] * a2[i];
+            s2[i] = s1[i];
+            s1[i] = tmp;
+        }
+    }
+    /// Sanitize (set to 0 if potentially denormal) filter state
+    inline void sanitize(int bands, int stages)
+    {
+        bands = padded(bands);
+        for (int j = 0; j < stages; j++)
+        {
+            for (int i = 0; i < bands; i++)
+            {
+                dsp::sanitize(w1[j][i]);
+                dsp::sanitize(w2[j][i]);
+            }
+        }
+    }
+    /// Reset state variables
+    inline void reset()
+    {
+        for (int j = 0; j < MaxStages; j++)
+        {
+            for (int i = 0; i < MaxBands; i++)
+                w1[j][i] = w2[j][i] = 0.0;
+        }
+    }
+};
+
 /**
  * Two-pole two-zero filter, for floating point values.
  * Uses "traditional" Direct I form (separate FIR and IIR halves).
@@ -125,7 +125,9 @@ struct simple_delay {
         T old, cur;
         get(old, delay);
         cur = in + fb*old;
+#if CALF_SAMPLE_SANITIZE
         sanitize(cur);
+#endif
         put(cur);
         return old;
     }
@@ -142,7 +144,9 @@ struct simple_delay {
         T old, cur;
         get_interp(old, delay>>16, dsp::fract16(delay));
         cur = in + fb*old;
+#if CALF_SAMPLE_SANITIZE
         sanitize(cur);
+#endif
         put(cur);
         return old;
     }
@@ -158,7 +162,9 @@ struct simple_delay {
         T old, cur;
         get(old, delay);
         cur = in + fb*old;
+#if CALF_SAMPLE_SANITIZE
         sanitize(cur);
+#endif
         put(cur);
         return old - fb * cur;
     }
@@ -174,7 +180,9 @@ struct simple_delay {
         T old, cur;
         get_interp(old, delay>>16, dsp::fract16(delay));
         cur = in + fb*old;
+#if CALF_SAMPLE_SANITIZE
         sanitize(cur);
+#endif
         put(cur);
         return old - fb * cur;
     }
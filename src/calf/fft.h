@@ -23,25 +23,27 @@
 #define __CALF_FFT_H
 
 #include <complex>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 namespace dsp {
 
-/// FFT routine copied from my old OneSignal library, modified to 
-/// match Calf's style. It's not fast at all, just a straightforward
-/// implementation.
+/// Bit reversal and twiddle tables for transforms of up to 2^O points. They only
+/// depend on T and O, so one read-only copy is shared by the whole process.
 template<class T, int O>
-class fft
+struct fft_tables
 {
-public:
     typedef typename std::complex<T> complex;
-private:
+    /// Bit reversed indexes (O bits wide, shift right for smaller orders)
     int scramble[1<<O];
-    complex sines[1<<O];
-public:
-    fft()
+    /// Twiddles of the pass combining pairs of 2^s point transforms are stored
+    /// contiguously at twiddles[2^s + k] = exp(2 pi i k / 2^(s+1)), k < 2^s
+    complex twiddles[1<<O];
+    
+    fft_tables()
     {
         int N=1<<O;
-        assert(N >= 4);
         for (int i=0; i<N; i++)
         {
             int v=0;
@@ -50,63 +52,150 @@ public:
                     v+=(N>>(j+1));
             scramble[i]=v;
         }
-        int N90 = N >> 2;
-        T divN = 2 * M_PI / N;
-        // use symmetry
-        for (int i=0; i<N90; i++)
+        twiddles[0] = 0;
+        for (int s=0; s<O; s++)
         {
-            T angle = divN * i;
-            T c = cos(angle), s = sin(angle);
-            sines[i + 3 * N90] = -(sines[i + N90] = complex(-s, c));
-            sines[i + 2 * N90] = -(sines[i] = complex(c, s));
+            int PO = 1<<s;
+            for (int k=0; k<PO; k++)
+            {
+                double angle = M_PI * k / PO;
+                twiddles[PO + k] = complex(cos(angle), sin(angle));
+            }
         }
     }
-    void calculate(complex *input, complex *output, bool inverse) const
+    /// The process-wide instance (created on first use, so create an fft object outside of the audio thread)
+    static const fft_tables &get()
     {
-        int N=1<<O;
-        int N1=N-1;
-        int i;
-        // Scramble the input data
-        if (inverse)
+        static fft_tables tables;
+        return tables;
+    }
+};
+
+/// First two passes in one go, as a radix-4 butterfly with trivial twiddles (1 and i)
+template<class T>
+inline void fft_pass_first4(std::complex<T> *data, int N)
+{
+    for (int b=0; b<N; b+=4)
+    {
+        std::complex<T> a0 = data[b] + data[b+1], a1 = data[b] - data[b+1];
+        std::complex<T> a2 = data[b+2] + data[b+3], a3 = data[b+2] - data[b+3];
+        std::complex<T> ia3(-a3.imag(), a3.real());
+        data[b] = a0 + a2;
+        data[b+2] = a0 - a2;
+        data[b+1] = a1 + ia3;
+        data[b+3] = a1 - ia3;
+    }
+}
+
+/// First pass alone (for odd orders), a radix-2 butterfly with no twiddle
+template<class T>
+inline void fft_pass_first2(std::complex<T> *data, int N)
+{
+    for (int b=0; b<N; b+=2)
+    {
+        std::complex<T> r1 = data[b], r2 = data[b+1];
+        data[b] = r1 + r2;
+        data[b+1] = r1 - r2;
+    }
+}
+
+/// Passes s and s+1 (PO = 2^s) fused into one radix-4 sweep over the data
+template<class T>
+inline void fft_pass4(std::complex<T> *data, int N, int PO, const std::complex<T> *twiddles)
+{
+    const std::complex<T> *w1 = twiddles + PO, *w2 = twiddles + 2 * PO, *w3 = twiddles + 3 * PO;
+    for (int b=0; b<N; b+=4*PO)
+    {
+        std::complex<T> *x0 = data + b, *x1 = x0 + PO, *x2 = x1 + PO, *x3 = x2 + PO;
+        for (int k=0; k<PO; k++)
         {
-            float mf=1.0/N;
-            for (i=0; i<N; i++)
-            {
-                complex &c=input[scramble[i]];
-                output[i]=mf*complex(c.imag(),c.real());
-            }
+            std::complex<T> t1 = x1[k] * w1[k], t3 = x3[k] * w1[k];
+            std::complex<T> a0 = x0[k] + t1, a1 = x0[k] - t1;
+            std::complex<T> a2 = (x2[k] + t3) * w2[k], a3 = (x2[k] - t3) * w3[k];
+            x0[k] = a0 + a2;
+            x2[k] = a0 - a2;
+            x1[k] = a1 + a3;
+            x3[k] = a1 - a3;
         }
-        else
-            for (i=0; i<N; i++)
-                output[i]=input[scramble[i]];
+    }
+}
+
+#if defined(__SSE__)
+/// Multiply two pairs of interleaved complex floats
+inline __m128 fft_cmul(__m128 a, __m128 w)
+{
+    const __m128 sign = _mm_set_ps(1.f, -1.f, 1.f, -1.f);
+    __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_add_ps(_mm_mul_ps(a, wr), _mm_mul_ps(_mm_mul_ps(as, wi), sign));
+}
 
-        // O butterfiles
-        for (i=0; i<O; i++)
+/// Single precision version of fft_pass4, two butterflies per iteration (PO must be at least 2)
+inline void fft_pass4(std::complex<float> *data, int N, int PO, const std::complex<float> *twiddles)
+{
+    const float *w1 = (const float *)(twiddles + PO), *w2 = (const float *)(twiddles + 2 * PO), *w3 = (const float *)(twiddles + 3 * PO);
+    for (int b=0; b<N; b+=4*PO)
+    {
+        float *x0 = (float *)(data + b), *x1 = x0 + 2 * PO, *x2 = x1 + 2 * PO, *x3 = x2 + 2 * PO;
+        for (int k=0; k<2*PO; k+=4)
         {
-            int PO=1<<i, PNO=1<<(O-i-1);
-            int j,k;
-            for (j=0; j<PNO; j++)
-            {
-                int base=j<<(i+1);
-                for (k=0; k<PO; k++)
-                {
-                    int B1=base+k;
-                    int B2=base+k+(1<<i);
-                    complex r1=output[B1];
-                    complex r2=output[B2];
-                    output[B1]=r1+r2*sines[(B1<<(O-i-1))&N1];
-                    output[B2]=r1+r2*sines[(B2<<(O-i-1))&N1];
-                }
-            }
+            __m128 v1 = _mm_loadu_ps(w1 + k);
+            __m128 t1 = fft_cmul(_mm_loadu_ps(x1 + k), v1), t3 = fft_cmul(_mm_loadu_ps(x3 + k), v1);
+            __m128 v0 = _mm_loadu_ps(x0 + k), v2 = _mm_loadu_ps(x2 + k);
+            __m128 a0 = _mm_add_ps(v0, t1), a1 = _mm_sub_ps(v0, t1);
+            __m128 a2 = fft_cmul(_mm_add_ps(v2, t3), _mm_loadu_ps(w2 + k));
+            __m128 a3 = fft_cmul(_mm_sub_ps(v2, t3), _mm_loadu_ps(w3 + k));
+            _mm_storeu_ps(x0 + k, _mm_add_ps(a0, a2));
+            _mm_storeu_ps(x2 + k, _mm_sub_ps(a0, a2));
+            _mm_storeu_ps(x1 + k, _mm_add_ps(a1, a3));
+            _mm_storeu_ps(x3 + k, _mm_sub_ps(a1, a3));
         }
-        if (inverse)
+    }
+}
+#endif
+
+/// Radix-4 FFT of up to 2^O points, with a real input path. The tables are
+/// shared between all instances of the same type (see fft_tables), so
+/// an fft object costs nothing but the first one of its type has to be
+/// created outside of the audio thread.
+template<class T, int O>
+class fft
+{
+public:
+    typedef typename std::complex<T> complex;
+    typedef fft_tables<T, O> tables;
+private:
+    const tables *tab;
+    /// Run the butterflies over a bit reversed block of 2^order points
+    void passes(complex *output, int order) const
+    {
+        int N=1<<order;
+        int s;
+        if (!order)
+            return;
+        if (order & 1)
         {
-            for (i=0; i<N; i++)
-            {
-                const complex &c=output[i];
-                output[i]=complex(c.imag(),c.real());
-            }
+            fft_pass_first2(output, N);
+            s = 1;
         }
+        else
+        {
+            fft_pass_first4(output, N);
+            s = 2;
+        }
+        for (; s + 1 < order; s += 2)
+            fft_pass4(output, N, 1 << s, tab->twiddles);
+    }
+public:
+    fft()
+    : tab(&tables::get())
+    {
+        assert((1<<O) >= 4);
+    }
+    void calculate(complex *input, complex *output, bool inverse) const
+    {
+        calculateN(input, output, inverse, O);
     }
     template<class InType>
     void calculateN(InType *input, complex *output, bool inverse, int order) const
@@ -114,15 +203,15 @@ public:
         assert(order <= O);
         int N=1<<order;
         int rsh=O - order;
-        int N1=(N-1) << rsh;
+        const int *scramble = tab->scramble;
         int i;
         // Scramble the input data
         if (inverse)
         {
-            float mf=1.0/N;
+            T mf=1.0/N;
             for (i=0; i<N; i++)
             {
-                const complex &c=input[scramble[i] >> rsh];
+                complex c=input[scramble[i] >> rsh];
                 output[i]=mf*complex(c.imag(),c.real());
             }
         }
@@ -130,25 +219,7 @@ public:
             for (i=0; i<N; i++)
                 output[i]=input[scramble[i] >> rsh];
 
-        // O butterfiles
-        for (i=0; i<order; i++)
-        {
-            int PO=1<<i, PNO=1<<(order-i-1);
-            int j,k;
-            for (j=0; j<PNO; j++)
-            {
-                int base=j<<(i+1);
-                for (k=0; k<PO; k++)
-                {
-                    int B1=base+k;
-                    int B2=base+k+(1<<i);
-                    complex r1=output[B1];
-                    complex r2=output[B2];
-                    output[B1]=r1+r2*sines[(B1<<(O-i-1))&N1];
-                    output[B2]=r1+r2*sines[(B2<<(O-i-1))&N1];
-                }
-            }
-        }
+        passes(output, order);
         if (inverse)
         {
             for (i=0; i<N; i++)
@@ -158,17 +229,29 @@ public:
             }
         }
     }
+    /// Transform 2^order real samples, as a 2^(order-1) point complex transform
+    /// of the even/odd sample pairs followed by a split into the real spectrum.
+    /// Output layout: output[i] = real part of bin i (0 <= i < 2^(order-1)),
+    /// output[2^order - 1 - i] = imaginary part of bin i (0 < i < 2^(order-1)).
+    /// @param tmp scratch space of 2^(order-1) complex values
     void execute_r2r(int order, float *input, float *output, complex *tmp, bool inverse = false) const
     {
-        calculateN<float>(input, tmp, inverse, order);
-        size_t s = 1 << order;
-        size_t s2 = 1 << (order - 1);
-        output[0] = tmp[0].real();
-        output[s2] = tmp[0].imag();
-        for (size_t i = 1; i < s2; ++i)
+        assert(order >= 2 && order <= O);
+        int s = 1 << order;
+        int s2 = 1 << (order - 1);
+        calculateN(reinterpret_cast<std::complex<float> *>(input), tmp, false, order - 1);
+        // the inverse transform of real data is the conjugate of the forward one, scaled
+        T re_scale = inverse ? T(1.0) / s : T(1), im_scale = inverse ? -re_scale : re_scale;
+        const complex *w = tab->twiddles + s2;
+        output[0] = (tmp[0].real() + tmp[0].imag()) * re_scale;
+        for (int i = 1; i < s2; ++i)
         {
-            output[i] = tmp[i].real();
-            output[s - 1 - i] = tmp[i].imag();
+            complex z = tmp[i], zc = std::conj(tmp[s2 - i]);
+            complex even = (z + zc) * T(0.5);
+            complex odd = (z - zc) * complex(0, -0.5);
+            complex x = even + w[i] * odd;
+            output[i] = x.real() * re_scale;
+            output[s - 1 - i] = x.imag() * im_scale;
         }
     }
 };
@@ -494,6 +494,11 @@ struct audio_module_iface
     virtual void params_reset() = 0;
     /// Called after instantiating (after all the feature pointers are set - including interfaces like progress_report_iface)
     virtual void post_instantiate(uint32_t sample_rate) = 0;
+    /// @return number of samples it takes the outputs to become silent after the inputs did, -1 if the plugin can produce sound out of silence
+    virtual int get_tail_length() = 0;
+    /// Called once when processing stops being done because the inputs and the tail are silent,
+    /// the output parameters (meters etc.) should be set to their idle values, as they won't be updated
+    virtual void on_sleep() = 0;
     /// Return the arrays of port buffer pointers
     virtual void get_port_arrays(float **&ins_ptrs, float **&outs_ptrs, float **&params_ptrs) = 0;
     /// Return metadata object
@@ -527,6 +532,8 @@ public:
     float *params[Metadata::param_count];
     bool questionable_data_reported_in;
     bool questionable_data_reported_out;
+    /// Number of samples of silence on all inputs processed so far
+    uint32_t silent_samples;
 
     progress_report_iface *progress_report;
 
@@ -537,6 +544,7 @@ public:
         memset(params, 0, sizeof(params));
         questionable_data_reported_in = false;
         questionable_data_reported_out = false;
+        silent_samples = 0;
     }
 
     /// Handle MIDI Note On
@@ -573,6 +581,10 @@ public:
     void params_reset() {}
     /// Called after instantiating (after all the feature pointers are set - including interfaces like progress_report_iface)
     void post_instantiate(uint32_t) {}
+    /// Never skip processing by default
+    int get_tail_length() { return -1; }
+    /// Nothing to do when not sleeping
+    void on_sleep() {}
     /// Handle 'message context' port message
     /// @arg output_ports pointer to bit array of output port "changed" flags, note that 0 = first audio input, not first parameter (use input_count + output_count)
     uint32_t message_run(const void *valid_ports, void *output_ports) {
@@ -603,7 +615,9 @@ public:
     /// utility function: call process, and if it returned zeros in output masks, zero out the relevant output port buffers
     uint32_t process_slice(uint32_t offset, uint32_t end)
     {
+        dsp::denormal_guard denormals;
         bool had_errors = false;
+        bool silent = Metadata::in_count > 0;
         for (int i=0; i<Metadata::in_count; ++i) {
             float *indata = ins[i];
             if (indata) {
@@ -614,6 +628,8 @@ public:
                         errval = indata[j];
                         had_errors = true;
                     }
+                    if (indata[j] != 0.f)
+                        silent = false;
                 }
                 if (had_errors && !questionable_data_reported_in) {
                     fprintf(stderr, "Warning: Plugin %s got questionable value %f on its input %d\n", Metadata::get_name(), errval, i);
@@ -621,6 +637,17 @@ public:
                 }
             }
         }
+        // once the inputs have been silent for longer than the tail, the outputs are silent too - skip the processing
+        int tail = silent ? get_tail_length() : -1;
+        if (tail < 0)
+            silent_samples = 0;
+        else if (silent_samples >= (uint32_t)tail)
+        {
+            zero_by_mask(0, offset, end - offset);
+            return 0;
+        }
+        else
+            silent_samples += end - offset;
         uint32_t total_out_mask = 0;
         while(offset < end)
         {
@@ -630,6 +657,9 @@ public:
             zero_by_mask(out_mask, offset, newend - offset);
             offset = newend;
         }
+        // this was the last call to process() before going to sleep
+        if (tail >= 0 && silent_samples >= (uint32_t)tail)
+            on_sleep();
         for (int i=0; i<Metadata::out_count; ++i) {
             if (total_out_mask & (1 << i))
             {
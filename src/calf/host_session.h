@@ -76,6 +76,8 @@ public:
     std::string autoconnect_midi;
     int autoconnect_midi_index;
     std::set<int> chains;
+    /// Link chained plugins directly instead of connecting their JACK ports
+    bool internal_chains;
     std::vector<jack_host *> plugins;
     main_window_iface *main_win;
     std::set<std::string> instances;
@@ -90,6 +92,8 @@ public:
     void close();
     bool activate_preset(int plugin, const std::string &preset, bool builtin);
     void remove_all_plugins();
+    /// Feed the inputs of plugin from the plugin with instance name source (does nothing if source is empty)
+    void link_internal_source(jack_host *plugin, const std::string &source);
     std::string get_next_instance_name(const std::string &effect_name);
     std::string get_full_plugin_name(const std::string &effect_name);
     
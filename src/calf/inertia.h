@@ -21,6 +21,7 @@
 #define __CALF_INERTIA_H
 
 #include "primitives.h"
+#include <algorithm>
 
 namespace dsp {
     
@@ -60,6 +61,12 @@ public:
     {
         return value + delta * count;
     }
+    /// Write the values of the next count steps to buffer (no dependency between elements, so it vectorizes)
+    inline void ramp_block(float value, float *buffer, int count)
+    {
+        for (int i = 0; i < count; i++)
+            buffer[i] = value + delta * (i + 1);
+    }
 };
     
 /// Algorithm for a constant time linear ramp
@@ -96,6 +103,12 @@ public:
     {
         return value * pow(delta, count);
     }
+    /// Write the values of the next count steps to buffer
+    inline void ramp_block(float value, float *buffer, int count)
+    {
+        for (int i = 0; i < count; i++)
+            buffer[i] = value *= delta;
+    }
 };
     
 /// Generic inertia using ramping algorithm specified as template argument. The basic idea
@@ -188,6 +201,32 @@ public:
             count = 0;
         }
     }
+    /// Write the smoothed values for the next numsamples samples to buffer (same as
+    /// numsamples calls of get()). If the value doesn't change over the block, the
+    /// buffer is left alone and false is returned - get_last() is the value then
+    inline bool get_block(float *buffer, unsigned int numsamples)
+    {
+        if (!count || !numsamples)
+            return false;
+        unsigned int steps = std::min(numsamples, count);
+        ramp.ramp_block(value, buffer, steps);
+        count -= steps;
+        if (count)
+            value = buffer[steps - 1];
+        else
+        {
+            // finished ramping, set to desired value to get rid of accumulated rounding errors
+            value = old_value;
+            dsp::fill(buffer + steps - 1, value, numsamples - steps + 1);
+        }
+        return true;
+    }
+    /// Write the smoothed values for the next numsamples samples to buffer, constant or not
+    inline void fill_block(float *buffer, unsigned int numsamples)
+    {
+        if (!get_block(buffer, numsamples))
+            dsp::fill(buffer, old_value, numsamples);
+    }
     /// Get last smoothed value, without affecting anything
     inline float get_last() const
     {
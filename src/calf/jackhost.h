@@ -28,6 +28,7 @@
 #include "utils.h"
 #include "vumeter.h"
 #include <pthread.h>
+#include <semaphore.h>
 #include <jack/jack.h>
 #include <jack/session.h>
 
@@ -47,21 +48,84 @@ struct automation_iface
     virtual ~automation_iface() {}
 };
 
+/// Immutable (apart from the per-cycle scratch space) copy of the plugin list used by the process callback
+struct jack_plugin_snapshot
+{
+    std::vector<jack_host *> plugins;
+    /// Number of plugins that have to finish before the Nth plugin can run (same indexing as plugins)
+    std::vector<int> dependencies;
+    /// Plugins that can only run after the Nth plugin has finished
+    std::vector<std::vector<int> > dependents;
+    /// Largest number of plugins that can run at the same time in the current graph
+    int graph_width;
+    /// Value of jack_client::graph_changes the dependency graph was built from
+    int graph_changes;
+    /// Per-cycle state of parallel processing
+    std::vector<int> pending, ready;
+    
+    jack_plugin_snapshot() : graph_width(1), graph_changes(0) {}
+};
+
 class jack_client {
 protected:
+    /// Plugin list as seen by the GUI thread, changes are published to the process callback via snapshot
     std::vector<jack_host *> plugins;
+    /// Serializes writers, never taken in the process callback
     calf_utils::ptmutex mutex;
+    /// Snapshot currently used by the process callback
+    jack_plugin_snapshot *volatile snapshot;
+    /// Incremented on entry to and exit from the process callback (odd = inside)
+    volatile unsigned int rt_cycle;
 
     /// Common port for MIDI parameter automation
     jack_port_t *automation_port;
 
+    /// Incremented by JACK whenever connections change
+    volatile int graph_changes;
+
+    /// Worker threads processing plugins alongside the JACK thread
+    std::vector<jack_native_thread_t> workers;
+    /// Number of workers the process callback may wake up
+    volatile int active_workers;
+    /// Posted once for each worker that should take part in the current cycle
+    sem_t worker_start;
+    /// Posted once for each plugin put in the ready queue, and once for each thread when the cycle is done
+    sem_t plugins_ready;
+    /// Posted by each worker when it has stopped touching the cycle state
+    sem_t workers_done;
+    volatile bool workers_quit;
+    /// Per-cycle state of parallel processing
+    volatile int ready_push, completed, cycle_threads;
+    jack_plugin_snapshot *cycle_snapshot;
+    jack_nframes_t cycle_nframes;
+    void *cycle_automation;
+
+    /// Fill run_before with (plugin, plugin connected to its inputs) pairs
+    void get_plugin_connections(std::multimap<int, int> &run_before);
+    /// Make the new snapshot visible to the process callback and free the old one once it is not in use
+    void publish_snapshot(jack_plugin_snapshot *new_snapshot);
+    /// Wait until the process callback no longer uses anything it could have seen before the call
+    void wait_for_process_cycle();
+    void process_parallel(jack_plugin_snapshot *snap, jack_nframes_t nframes, void *automation_data);
+    void run_ready_plugins();
+    int take_ready_plugin();
+    void process_plugin(int index);
+    void start_workers();
+    void stop_workers();
+    static void *worker_thread(void *p);
+
 public:
     jack_client_t *client;
     int input_nr, output_nr, midi_nr;
     std::string name, input_name, output_name, midi_name;
     int sample_rate;
+    /// Number of threads processing plugins, including the JACK thread (1 = process everything in the JACK thread)
+    int thread_count;
+    /// Zeroed buffer of the current period size, read by internally linked inputs whose source has no buffer yet
+    std::vector<float> silence;
 
     jack_client();
+    ~jack_client();
     void add(jack_host *plugin);
     void del(jack_host *plugin);
     void open(const char *client_name, const char *jack_session_id);
@@ -74,16 +138,29 @@ public:
     void connect(const std::string &p1, const std::string &p2);
     void close();
     void apply_plugin_order(const std::vector<int> &indices);
+    /// Feed the inputs of plugin to with outputs of plugin from directly, replacing the JACK input ports of to.
+    /// Plugins are reordered so that from runs first.
+    /// @return false (and nothing is changed) if from cannot run before to because of other connections
+    bool link_internal(jack_host *from, jack_host *to);
+    /// Undo link_internal, registering the JACK input ports again
+    void unlink_internal(jack_host *to);
     void calculate_plugin_order(std::vector<int> &indices);
+    /// Rebuild the dependency graph used for parallel processing from the current JACK connections
+    void update_plugin_graph();
+    /// @return true if JACK connections changed since the last update_plugin_graph call
+    bool is_plugin_graph_stale() { return graph_changes != snapshot->graph_changes; }
     const char **get_ports(const char *name_re, const char *type_re, unsigned long flags);
     
     static int do_jack_process(jack_nframes_t nframes, void *p);
     static int do_jack_bufsize(jack_nframes_t numsamples, void *p);
+    static int do_jack_graph_order(void *p);
+    /// Swap a pointer read by the process callback, v2 may be freed after the call returns
     template<class T>
     void atomic_swap(T &v1, T &v2)
     {
         calf_utils::ptlock lock(mutex);
         std::swap(v1, v2);
+        wait_for_process_cycle();
     }
 };
 
@@ -94,13 +171,36 @@ public:
         float *data;
         std::string name, nice_name;
         dsp::vumeter meter;
-        port() : handle(NULL), data(NULL) {}
+        /// Output port of another plugin in the same client that this input reads directly (no JACK port is registered then)
+        port *source;
+        port() : handle(NULL), data(NULL), source(NULL) {}
         ~port() { }
     };
 public:
     float **ins, **outs, **params;
     std::vector<port> inputs, outputs;
     float *param_values;
+    /// Parameter change made by the GUI thread, timestamped with JACK frame time
+    struct param_event {
+        jack_nframes_t time;
+        int param_no;
+        float value;
+    };
+    enum { param_event_queue_size = 4096 };
+    /// Single producer (GUI thread), single consumer (process callback) ring of parameter changes
+    std::vector<param_event> param_events;
+    volatile int param_events_write, param_events_read;
+    /// Parameter values as last set by the GUI thread, used until the process callback catches up
+    std::vector<float> gui_values;
+    /// Number of events queued by the GUI thread and applied by the process callback
+    int gui_events_sent;
+    volatile int gui_events_applied;
+    /// Set by the GUI thread when the queue overflowed and all values need to be copied from gui_values
+    volatile int gui_resync;
+    /// JACK frame time of offset 0 for the events applied in the current cycle
+    jack_nframes_t event_origin;
+    /// Parameter changes are queued once the plugin is handed to the process callback, written directly before that
+    bool rt_owned;
     float midi_meter;
     audio_module_iface *module;
     automation_map *cc_mappings;
@@ -113,6 +213,8 @@ public:
     jack_client *client;
     bool changed;
     port midi_port;
+    /// Plugin whose outputs feed the inputs of this one without going through JACK, or NULL
+    jack_host *internal_source;
     std::string name;
     std::string instance_name;
     int in_count, out_count, param_count;
@@ -132,6 +234,12 @@ public:
     void handle_event(uint8_t *buffer, uint32_t size);
     /// Process audio and update meters
     void process_part(unsigned int time, unsigned int len);
+    /// Process audio from time to end, splitting at automation and parameter events
+    void process_until(unsigned int time, unsigned int end, automation_iface &automation);
+    /// Apply queued parameter changes up to start, @return time of the next change if before end, or end
+    uint32_t apply_param_events(uint32_t start, uint32_t end);
+    /// Copy GUI values after a queue overflow (process callback)
+    void apply_gui_resync();
     /// Get meter value for the Nth port
     virtual float get_level(unsigned int port);
     /// Process audio/MIDI buffers
@@ -153,15 +261,8 @@ public:
 public:
     // Implementations of methods in plugin_ctl_iface 
     bool activate_preset(int bank, int program) { return false; }
-    virtual float get_param_value(int param_no) {
-        assert(param_no >= 0 && param_no < param_count);
-        return param_values[param_no];
-    }
-    virtual void set_param_value(int param_no, float value) {
-        assert(param_no >= 0 && param_no < param_count);
-        param_values[param_no] = value;
-        changed = true;
-    }
+    virtual float get_param_value(int param_no);
+    virtual void set_param_value(int param_no, float value);
     virtual std::string get_instance_name() { return instance_name; }
     virtual void execute(int cmd_no) { module->execute(cmd_no); }
     virtual char *configure(const char *key, const char *value);
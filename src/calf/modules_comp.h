@@ -151,6 +151,9 @@ public:
     void deactivate();
     void params_changed();
     void set_sample_rate(uint32_t sr);
+    /// Silence in, silence out - just let the meters fall
+    int get_tail_length() { return srate; }
+    void on_sleep() { meters.reset(); }
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
     bool get_graph(int index, int subindex, int phase, float *data, int points, cairo_iface *context, int *mode) const;
     bool get_dot(int index, int subindex, int phase, float &x, float &y, int &size, cairo_iface *context) const;
@@ -317,6 +320,9 @@ public:
     void deactivate();
     void params_changed();
     void set_sample_rate(uint32_t sr);
+    /// Silence in, silence out - just let the meters fall
+    int get_tail_length() { return srate; }
+    void on_sleep() { meters.reset(); }
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
     bool get_graph(int index, int subindex, int phase, float *data, int points, cairo_iface *context, int *mode) const;
     bool get_dot(int index, int subindex, int phase, float &x, float &y, int &size, cairo_iface *context) const;
@@ -58,6 +58,9 @@ public:
     void activate();
     void set_sample_rate(uint32_t sr);
     void deactivate();
+    /// Decay time is roughly RT60, allow twice that for the tail to reach -120 dB, plus some margin
+    int get_tail_length() { return (int)(4 * *params[par_decay] * srate) + predelay_amt; }
+    void on_sleep() { meters.reset(); }
 };
 
 /**********************************************************************
@@ -89,6 +92,8 @@ public:
     void deactivate();
     void set_sample_rate(uint32_t sr);
     void calc_filters();
+    int get_tail_length();
+    void on_sleep() { meters.reset(); }
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
     virtual char *configure(const char *key, const char *value);
     
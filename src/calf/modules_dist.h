@@ -25,6 +25,7 @@
 #include <limits.h>
 #include "biquad.h"
 #include "bypass.h"
+#include "delay.h"
 #include "audio_fx.h"
 #include "giface.h"
 #include "metadata.h"
@@ -46,6 +47,8 @@ private:
     dsp::biquad_d2 lp[2][4], hp[2][4];
     dsp::biquad_d2 p[2];
     dsp::tap_distortion dist[2];
+    /// Delays the dry signal by the latency of dist, so that mixing them doesn't comb filter
+    dsp::simple_delay<64, float> dry_delay[2];
     dsp::bypass bypass;
     vumeters meters;
 public:
@@ -71,6 +74,8 @@ private:
     dsp::biquad_d2 hp[2][4];
     dsp::biquad_d2 lp[2][2];
     dsp::tap_distortion dist[2];
+    /// Delays the dry signal by the latency of dist, so that mixing them doesn't comb filter
+    dsp::simple_delay<64, float> dry_delay[2];
     dsp::bypass bypass;
     vumeters meters;
 public:
@@ -96,6 +101,8 @@ private:
     dsp::biquad_d2 lp[2][4];
     dsp::biquad_d2 hp[2][2];
     dsp::tap_distortion dist[2];
+    /// Delays the dry signal by the latency of dist, so that mixing them doesn't comb filter
+    dsp::simple_delay<64, float> dry_delay[2];
     dsp::bypass bypass;
     vumeters meters;
 public:
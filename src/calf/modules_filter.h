@@ -54,6 +54,12 @@ public:
 private:
     analyzer _analyzer;
     enum { graph_param_count = BaseClass::last_graph_param - BaseClass::first_graph_param + 1, params_per_band = AM::param_p2_active - AM::param_p1_active };
+    /// One active filter of the chain; route is the band's active mode (1 = L+R, 2 = L, 3 = R, 4 = M, 5 = S)
+    struct eq_stage {
+        dsp::biquad_d2 *left, *right;
+        int route;
+    };
+    enum { max_stages = 3 + 3 + 2 + PeakBands };
     float hp_mode_old, hp_freq_old, hp_q_old;
     float lp_mode_old, lp_freq_old, lp_q_old;
     float ls_level_old, ls_freq_old, ls_q_old;
@@ -68,9 +74,13 @@ private:
     dsp::biquad_d2 lsL, lsR, hsL, hsR;
     dsp::biquad_d2 pL[PeakBands], pR[PeakBands];
     dsp::bypass bypass;
+    eq_stage stages[max_stages];
+    int stage_count;
     int keep_gliding;
+    float glide_steps;
     mutable int last_peak;
-    inline void process_hplp(float &left, float &right);
+    void add_stage(dsp::biquad_d2 *left, dsp::biquad_d2 *right, int route);
+    void build_stages();
 public:
     typedef std::complex<double> cfloat;
     uint32_t srate;
@@ -95,6 +105,9 @@ public:
         int clip[] = {AM::param_clip_inL, AM::param_clip_inR, AM::param_clip_outL, AM::param_clip_outR};
         meters.init(params, meter, clip, 4, sr);
     }
+    /// Give the filters and the meters a second to settle
+    int get_tail_length() { return srate; }
+    void on_sleep() { meters.reset(); }
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
 };
 
@@ -131,6 +144,9 @@ public:
     void deactivate();
     void params_changed();
     void set_sample_rate(uint32_t sr);
+    /// Give the filters and the meters a second to settle
+    int get_tail_length() { return srate; }
+    void on_sleep() { meters.reset(); }
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
 };
 
@@ -377,7 +393,8 @@ public:
     uint32_t srate;
     bool is_active;
     float * buffer;
-    float in[channels];
+    /// Input scaled by the input level, split by the crossover one block at a time
+    float split_in[channels][MAX_SAMPLE_RUN];
     unsigned int pos;
     unsigned int buffer_size;
     int last_peak;
@@ -416,7 +433,11 @@ public:
     uint32_t srate;
     bool is_active;
     static const int maxorder = 8;
-    dsp::biquad_d2 detector[2][maxorder][32], modulator[2][maxorder][32];
+    /// Band pass filter of each band (for the graph), all the stages in the banks use the same coefficients
+    dsp::biquad_coeffs band_coeffs[32];
+    dsp::biquad_d2_bank<32, maxorder> detector[2], modulator[2];
+    dsp::xorshift_noise noise;
+    float noise_buf[2][MAX_SAMPLE_RUN];
     dsp::bypass bypass;
     double env_mods[2][32];
     vumeters meters;
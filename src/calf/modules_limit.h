@@ -43,7 +43,10 @@ private:
     uint32_t asc_led;
     int mode, mode_old, oversampling_old;
     dsp::lookahead_limiter limiter;
-    dsp::resampleN resampler[2];
+    dsp::oversampler resampler[2];
+    // a run at the base rate and oversampled, the oversampling parameter goes up to 4
+    float run_buf[2][MAX_SAMPLE_RUN];
+    float over_buf[2][MAX_SAMPLE_RUN * 4];
     dsp::bypass bypass;
     vumeters meters;
 public:
@@ -75,7 +78,7 @@ private:
     bool no_solo;
     dsp::lookahead_limiter strip[strips];
     dsp::lookahead_limiter broadband;
-    dsp::resampleN resampler[strips][2];
+    dsp::oversampler resampler[strips][2];
     dsp::crossover crossover;
     dsp::bypass bypass;
     float over;
@@ -118,7 +121,7 @@ private:
     bool no_solo;
     dsp::lookahead_limiter strip[strips];
     dsp::lookahead_limiter broadband;
-    dsp::resampleN resampler[strips][2];
+    dsp::oversampler resampler[strips][2];
     dsp::crossover crossover;
     dsp::bypass bypass;
     float over;
@@ -20,17 +20,27 @@ namespace calf_plugins {
 class pitch_audio_module: public audio_module<pitch_metadata>, public line_graph_iface
 {
 protected:
-    typedef dsp::fft<float, 12> pfft;
-    enum { BufferSize = 4096 };
+    enum { BufferOrder = 12, BufferSize = 1 << BufferOrder };
+    typedef dsp::fft<float, BufferOrder> pfft;
+    /// Steps of the autocorrelation, one per process() call so that no single block pays for all of it
+    enum stage_t { STAGE_IDLE, STAGE_SPECTRUM, STAGE_AUTOCORR, STAGE_PEAK };
     uint32_t srate;
     pfft transform;
     float inputbuf[BufferSize];
-    pfft::complex waveform[2 * BufferSize], spectrum[2 * BufferSize], autocorr[2 * BufferSize];
+    float window[BufferSize];
+    /// windowed input, spectrum (in dsp::fft::execute_r2r layout), power spectrum, autocorrelation
+    float waveform[BufferSize], spectrum[BufferSize], power[BufferSize], autocorr[BufferSize];
+    pfft::complex fft_temp[BufferSize / 2];
+    /// Spectrum value at Nyquist frequency (not part of the r2r output)
+    float nyquist;
     float magarr[BufferSize / 2];
     float sumsquares[BufferSize + 1], sumsquares_last;
     uint32_t write_ptr;
+    stage_t stage;
     
-    void recompute();
+    void start_recompute();
+    void recompute_step();
+    void find_pitch();
 public:
     typedef pitch_audio_module AM;
 
@@ -49,7 +49,7 @@ class stereo_audio_module:
     uint32_t srate;
     bool active;
     dsp::bypass bypass;
-    float meter_inL, meter_inR, meter_outL, meter_outR, meter_phase;
+    float meter_phase;
     vumeters meters;
     
     float * buffer;
@@ -82,7 +82,6 @@ class mono_audio_module:
     uint32_t srate;
     bool active;
     dsp::bypass bypass;
-    float meter_in, meter_outL, meter_outR;
     vumeters meters;
     
     float * buffer;
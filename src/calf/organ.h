@@ -188,6 +188,36 @@ public:
     void process(organ_parameters *parameters, float (*data)[2], unsigned int len, float sample_rate);
 };
 
+/// Line box of the scanner vibrato: a cascade of 2nd order lowpass filters (with loss compensation)
+/// alternating between two slightly different cutoffs. All the stages run at once as a wavefront -
+/// stage k works on sample i - k while stage 0 works on sample i - so the cascade vectorises across
+/// stages (4 per SSE register) instead of being one long chain of dependent biquads per sample.
+class scanner_line_box
+{
+public:
+    enum {
+        /// Number of filter stages
+        Stages = 18,
+        /// Stages rounded up to whole SIMD registers (extra lanes are computed and ignored)
+        Lanes = 20,
+        /// Largest block that can be processed in one call
+        MaxBlock = 64,
+    };
+    scanner_line_box();
+    void reset();
+    /// Set the filter coefficients (only recalculated when the sample rate changes)
+    void set_sample_rate(float sample_rate);
+    /// Run len <= MaxBlock samples of input through the cascade. The output of stage k for input
+    /// sample i ends up in out[i + k][k], so out must have room for len + Stages - 1 rows.
+    void process(const float *input, float (*out)[Lanes], unsigned int len);
+protected:
+    /// Direct form II state of every stage
+    float w1[Lanes], w2[Lanes];
+    /// Coefficients of even and odd stages: a0, a1, a2, b1, b2
+    float coeffs[2][5];
+    float srate;
+};
+
 /// A more sophisticated simulation of scanner vibrato. Simulates a line box
 /// and an interpolating scanner. The line box is a series of 18 2nd order
 /// lowpass filters with cutoff frequency ~4kHz, with loss compensation.
@@ -195,8 +225,6 @@ public:
 /// selected outputs of the line box.
 ///
 /// @note
-/// This is a true CPU hog, and it should be optimised some day.
-/// @note
 /// The line box is mono. 36 lowpass filters might be an overkill.
 /// @note 
 /// See also: http://www.jhaible.de/interpolating_scanner_and_scanvib/jh_interpolating_scanner_and_scanvib.html
@@ -204,9 +232,8 @@ public:
 class scanner_vibrato
 {
 protected:
-    enum { ScannerSize = 18 };
     float lfo_phase;
-    dsp::biquad_d2 scanner[ScannerSize];
+    scanner_line_box line_box;
     organ_vibrato legacy;
 public:
     void reset();
@@ -230,6 +257,18 @@ protected:
     /// The envelopes have ended and the voice is in final fadeout stage
     bool finishing;
     dsp::inertia<dsp::exponential_ramp> inertia_pitchbend;
+    /// Gains of the amplitude controls (direct, filter 1, filter 2, all) at the start of the current block and their per-sample steps
+    float amp_start[ampctl_count - 1], amp_step[ampctl_count - 1];
+
+    /// First part of render_block: drawbars, envelopes and filter coefficients
+    /// @return false if the voice has nothing more to render in this block
+    bool prepare_block();
+    /// Second part of render_block: filters and amplitude controls
+    void filter_block();
+    /// filter_block of two voices at once, one voice per SIMD lane
+    static void filter_block_pair(organ_voice *v1, organ_voice *v2);
+    /// Last part of render_block: voice vibrato, release fade and percussion
+    void finish_block();
 
 public:
     organ_voice()
@@ -246,6 +285,8 @@ public:
     virtual float get_priority() { return stolen ? 20000 : (perc_released ? 1 : (sostenuto ? 200 : 100)); }
     virtual void steal();
     void render_block(int current_snapshot);
+    /// Render the next block of several voices, with the filters of two voices running side by side
+    static void render_blocks(organ_voice **voices, int count, int current_snapshot);
     
     virtual int get_current_note() {
         return note;
@@ -23,7 +23,6 @@
 #define CALF_OSC_H
 
 #include "fft.h"
-#include <map>
 
 namespace dsp
 {
@@ -158,32 +157,63 @@ struct bandlimiter
     }
 };
 
-/// Set of bandlimited wavetables
+/// Set of bandlimited wavetables. The tables are stored in one block, ordered from the one with most
+/// harmonics (used for lowest pitches) up, and selected in constant time: the octave of the phase delta
+/// picks the first candidate, which is at most a few ordered compares away from the right one.
 template<int SIZE_BITS>
-struct waveform_family: public std::map<uint32_t, float *>
+struct waveform_family
 {
-    enum { SIZE = 1 << SIZE_BITS };
-    using std::map<uint32_t, float *>::iterator;
-    using std::map<uint32_t, float *>::end;
-    using std::map<uint32_t, float *>::lower_bound;
-    float original[SIZE];
+    enum {
+        SIZE = 1 << SIZE_BITS,
+        /// Distance between tables - padded so that every table starts 16-byte aligned
+        TABLE_STRIDE = SIZE + 4,
+        /// Upper bound on number of levels (cutoff shrinks to 3/4 each level, 2.4 levels per octave)
+        MAX_LEVELS = 3 * SIZE_BITS,
+        /// Phase delta to level key shift - a key is the harmonic count divisor top / cutoff
+        KEY_SHIFT = 32 - SIZE_BITS,
+    };
+    /// Original (not bandlimited) waveform, SIZE samples
+    float *original;
+    /// Tables (and the original) live in memory owned by someone else, e.g. a mapped cache file
+    bool shared;
+    
+    waveform_family()
+    : original(NULL)
+    , shared(false)
+    , count(0)
+    , storage(NULL)
+    {
+        clear_levels();
+    }
     
     /// Fill the family using specified bandlimiter and original waveform. Optionally apply foldover. 
     /// Does not produce harmonics over specified limit (limit = (SIZE / 2) / min_number_of_harmonics)
     void make(bandlimiter<SIZE_BITS> &bl, float input[SIZE], bool foldover = false, uint32_t limit = SIZE / 2)
     {
-        memcpy(original, input, sizeof(original));
+        set_original(input);
         bl.compute_spectrum(input);
         make_from_spectrum(bl, foldover);
     }
     
+    /// Store a copy of SIZE samples of src as the original waveform
+    void set_original(const float *src)
+    {
+        if (shared)
+            free_tables();
+        if (!original)
+            original = new float[SIZE];
+        memcpy(original, src, SIZE * sizeof(float));
+    }
+    
     /// Fill the family using specified bandlimiter and spectrum contained within. Optionally apply foldover. 
     /// Does not produce harmonics over specified limit (limit = (SIZE / 2) / min_number_of_harmonics)
     void make_from_spectrum(bandlimiter<SIZE_BITS> &bl, bool foldover = false, uint32_t limit = SIZE / 2)
     {
         bl.remove_dc();
         
-        uint32_t base = 1 << (32 - SIZE_BITS);
+        // first find the cutoff of every level, so that all tables can go into one allocation
+        uint32_t level_keys[MAX_LEVELS], cutoffs[MAX_LEVELS];
+        unsigned int levels = 0;
         uint32_t cutoff = SIZE / 2, top = SIZE / 2;
         float vmax = 0;
         for (unsigned int i = 0; i < cutoff; i++)
@@ -203,31 +233,125 @@ struct waveform_family: public std::map<uint32_t, float *>
                     cutoff--;
                 }
             }
-            float *wf = new float[SIZE+1];
-            bl.make_waveform(wf, cutoff, foldover);
-            wf[SIZE] = wf[0];
-            float **storage = &(*this)[base * (top / cutoff)];
-            delete[] *storage;
-            *storage = wf;
+            // a level with the same key as the previous one replaces it
+            uint32_t key = top / cutoff;
+            if (!levels || level_keys[levels - 1] != key)
+                levels++;
+            level_keys[levels - 1] = key;
+            cutoffs[levels - 1] = cutoff;
             cutoff = (int)(0.75 * cutoff);
         }
+        
+        if (shared)
+            free_tables();
+        else
+            free_levels();
+        float *tables = allocate(levels);
+        for (unsigned int i = 0; i < levels; i++)
+        {
+            float *wf = tables + i * TABLE_STRIDE;
+            bl.make_waveform(wf, cutoffs[i], foldover);
+            wf[SIZE] = wf[0];
+        }
+        set_levels(level_keys, tables, levels);
+    }
+    
+    /// Use externally owned tables instead of computing them: orig is the original waveform
+    /// (SIZE samples), tables holds count bandlimited tables TABLE_STRIDE samples apart, keys[i]
+    /// is the phase delta below which the table i can be used. The memory must outlive the family
+    /// and is never freed by it.
+    void attach(float *orig, const uint32_t *keys, float *tables, unsigned int count)
+    {
+        free_tables();
+        shared = true;
+        original = orig;
+        uint32_t level_keys[MAX_LEVELS];
+        for (unsigned int i = 0; i < count && i < MAX_LEVELS; i++)
+            level_keys[i] = keys[i] >> KEY_SHIFT;
+        set_levels(level_keys, tables, std::min<unsigned int>(count, MAX_LEVELS));
     }
     
+    /// Number of bandlimited tables
+    inline unsigned int size() const { return count; }
+    /// The phase delta below which the i-th table can be used
+    inline uint32_t get_key(unsigned int i) const { return keys[i] << KEY_SHIFT; }
+    /// i-th table, SIZE + 1 samples (the last one is a copy of the first)
+    inline float *get_table(unsigned int i) const { return level_tables[i]; }
+    
     /// Retrieve waveform pointer suitable for specified phase_delta
-    inline float *get_level(uint32_t phase_delta)
+    inline float *get_level(uint32_t phase_delta) const
     {
-        iterator i = upper_bound(phase_delta);
-        if (i == end())
-            return NULL;
-        // printf("Level = %08x\n", i->first);
-        return i->second;
+        uint32_t key = phase_delta >> KEY_SHIFT;
+        unsigned int i = first_level[key ? 32 - __builtin_clz(key) : 0];
+        // the last key is a sentinel larger than any key, with a NULL table
+        while (keys[i] <= key)
+            i++;
+        return level_tables[i];
     }
-    /// Destructor, deletes the waveforms and removes them from the map.
+    /// Destructor, deletes the waveforms.
     ~waveform_family()
     {
-        for (iterator i = begin(); i != end(); i++)
-            delete []i->second;
-        clear();
+        free_tables();
+    }
+private:
+    /// Number of levels
+    unsigned int count;
+    /// Level keys in ascending order, followed by a sentinel
+    uint32_t keys[MAX_LEVELS + 1];
+    /// Level tables, followed by NULL
+    float *level_tables[MAX_LEVELS + 1];
+    /// Index of the first level usable for keys in [2^(i-1), 2^i) (for i = 0, a key of 0)
+    uint8_t first_level[SIZE_BITS + 1];
+    /// Allocated table memory (NULL when shared)
+    float *storage;
+    
+    /// Allocate zeroed memory for levels tables, returns the first (aligned) one
+    float *allocate(unsigned int levels)
+    {
+        storage = new float[levels * TABLE_STRIDE + 4]();
+        return (float *)(((uintptr_t)storage + 15) & ~(uintptr_t)15);
+    }
+    void set_levels(const uint32_t *level_keys, float *tables, unsigned int levels)
+    {
+        count = levels;
+        for (unsigned int i = 0; i < levels; i++)
+        {
+            keys[i] = level_keys[i];
+            level_tables[i] = tables + i * TABLE_STRIDE;
+        }
+        keys[levels] = ~0U;
+        level_tables[levels] = NULL;
+        unsigned int level = 0;
+        for (unsigned int i = 0; i <= SIZE_BITS; i++)
+        {
+            uint32_t lowest = i ? 1 << (i - 1) : 0;
+            while (keys[level] <= lowest)
+                level++;
+            first_level[i] = level;
+        }
+    }
+    void clear_levels()
+    {
+        count = 0;
+        keys[0] = ~0U;
+        level_tables[0] = NULL;
+        for (unsigned int i = 0; i <= SIZE_BITS; i++)
+            first_level[i] = 0;
+    }
+    void free_levels()
+    {
+        if (!shared)
+            delete []storage;
+        storage = NULL;
+        clear_levels();
+    }
+    void free_tables()
+    {
+        free_levels();
+        if (!shared)
+            delete []original;
+        original = NULL;
+        shared = false;
     }
 };
 
@@ -66,11 +66,38 @@ public:
             }
         }
     }
+    /// Update all meters from a block of numsamples samples, the same as calling
+    /// process() for every sample: data[i] is the signal of meter i (NULL for silence)
+    void process(const float *const *data, uint32_t numsamples) {
+        for (size_t i = 0; i < meters.size(); ++i) {
+            meter_data &md = meters[i];
+            float *level = md.level_idx != -1 ? params[abs(md.level_idx)] : NULL;
+            float *clip = md.clip_idx != -1 ? params[abs(md.clip_idx)] : NULL;
+            if (!level && !clip)
+                continue;
+            md.meter.process_block(data[i], numsamples);
+            if (level)
+                *level = md.meter.level;
+            if (clip)
+                *clip = md.meter.clip > 0 ? 1.f : 0.f;
+        }
+    }
     void fall(unsigned int numsamples) {
         for (size_t i = 0; i < meters.size(); ++i)
             if (meters[i].level_idx != -1)
                 meters[i].meter.fall(numsamples);
     }
+    /// Put all meters (and their parameters) back in the idle state - no signal, no clip
+    void reset() {
+        for (size_t i = 0; i < meters.size(); ++i) {
+            meter_data &md = meters[i];
+            md.meter.reset();
+            if (md.level_idx != -1 && params[abs(md.level_idx)])
+                *params[abs(md.level_idx)] = md.meter.level;
+            if (md.clip_idx != -1 && params[abs(md.clip_idx)])
+                *params[abs(md.clip_idx)] = 0.f;
+        }
+    }
 };
 
 struct debug_send_configure_iface: public send_configure_iface
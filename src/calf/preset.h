@@ -100,6 +100,8 @@ struct preset_list
         int output_index;
         /// Index of the first MIDI port
         int midi_index;
+        /// Instance name of the plugin feeding the inputs directly (empty if the inputs are JACK ports)
+        std::string internal_source;
         /// Automation assignments for this plugin
         std::vector<std::pair<std::string, std::string> > automation_entries;
         
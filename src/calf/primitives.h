@@ -28,6 +28,19 @@
 #include <cmath>
 #include <cstdlib>
 #include <map>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/// Per-sample denormal protection in the inner loops (sanitizing filter state on
+/// every sample etc.). Configure with --disable-sample-sanitize to leave denormals
+/// to the FTZ/DAZ mode set by denormal_guard instead. That mode only covers SSE
+/// math, so on x87 builds the per-sample code stays in.
+#if defined(CALF_NO_SAMPLE_SANITIZE) && defined(__SSE2_MATH__)
+#define CALF_SAMPLE_SANITIZE 0
+#else
+#define CALF_SAMPLE_SANITIZE 1
+#endif
 
 namespace dsp {
 
@@ -342,6 +355,30 @@ public:
     }
 };
 
+/**
+ * Switches the SSE unit to flush denormal results to zero (FTZ) and to treat
+ * denormal inputs as zero (DAZ) for the lifetime of the object, then restores
+ * the previous mode. Put one on the stack of every audio entry point; nesting
+ * is harmless.
+ */
+class denormal_guard
+{
+#if defined(__SSE__)
+    unsigned int old_mxcsr;
+public:
+    denormal_guard()
+    {
+        old_mxcsr = _mm_getcsr();
+        // 0x8000 = FTZ, 0x0040 = DAZ
+        _mm_setcsr(old_mxcsr | 0x8040);
+    }
+    ~denormal_guard()
+    {
+        _mm_setcsr(old_mxcsr);
+    }
+#endif
+};
+
 /**
  * Force "small enough" float value to zero
  */
@@ -411,6 +448,45 @@ inline float fract16(unsigned int value)
     return (value & 0xFFFF) * (1.0 / 65536.0);
 }
 
+/**
+ * Uniform noise in [0, 1), four independent xorshift generators side by side,
+ * so that filling a buffer compiles to vector code (and it's per instance, unlike rand())
+ */
+class xorshift_noise
+{
+public:
+    enum { lanes = 4 };
+    uint32_t state[lanes];
+    
+    xorshift_noise(uint32_t seed = 1)
+    {
+        set_seed(seed);
+    }
+    void set_seed(uint32_t seed)
+    {
+        for (int l = 0; l < lanes; l++)
+            state[l] = ((seed + l) * 2654435761U) | 1;
+    }
+    /// Fill numsamples values of buf
+    inline void fill(float *buf, uint32_t numsamples)
+    {
+        uint32_t i = 0;
+        for (; i + lanes <= numsamples; i += lanes)
+            for (int l = 0; l < lanes; l++)
+                buf[i + l] = step(state[l]);
+        for (int l = 0; i < numsamples; i++, l++)
+            buf[i] = step(state[l]);
+    }
+private:
+    static inline float step(uint32_t &x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return (x >> 8) * (1.f / 16777216.f);
+    }
+};
+
 /**
  * typical precalculated sine table
  */
@@ -193,16 +193,24 @@ public:
                 read_ptr = 0;
             }
             int ncopy = std::min<int>(BlockSize - read_ptr, nsamples - p);
-            for (int i = 0; i < ncopy; i++)
-                for (int c = 0; c < Channels; c++)
-                    buf[p + i][c] += output_buffer[read_ptr + i][c];
+            mix_to(buf + p, ncopy);
             p += ncopy;
-            read_ptr += ncopy;
         }
     }
+    /// Add the next ncopy (no more than BlockSize - read_ptr) samples of the current block to buf
+    inline void mix_to(float (*buf)[2], int ncopy)
+    {
+        // both buffers are interleaved with the same channel count, so
+        // the mixdown is a single contiguous (vectorisable) add
+        float *__restrict dst = &buf[0][0];
+        const float *__restrict src = &output_buffer[read_ptr][0];
+        for (int i = 0; i < ncopy * Channels; i++)
+            dst[i] += src[i];
+        read_ptr += ncopy;
+    }
 };
 
-#define for_all_voices(iter) for (dsp::voice **iter = active_voices.begin(); iter != active_voices.end(); iter++)
+#define for_all_voices(iter) for (dsp::voice **iter = first_active_voice(); iter; iter = next_active_voice(iter))
     
 /// A basic preallocated var-array with append and 
 template<class T>
@@ -269,11 +277,50 @@ struct basic_pool {
         delete []items;
     }
 };
+/// A set of voice slots (indexes into basic_synth::allocated_voices)
+/// kept as a single 64-bit mask, so that membership, counting and
+/// iteration are a handful of bit operations
+struct voice_slot_set {
+    enum { MaxSlots = 64 };
+    uint64_t bits;
+
+    voice_slot_set() : bits(0) {}
+
+    bool empty() const { return bits == 0; }
+    size_t size() const { return __builtin_popcountll(bits); }
+    bool contains(int slot) const { return (bits >> slot) & 1; }
+    void add(int slot) { bits |= 1ULL << slot; }
+    void remove(int slot) { bits &= ~(1ULL << slot); }
+    /// Lowest slot in the set, or -1 if the set is empty
+    int first() const { return bits ? __builtin_ctzll(bits) : -1; }
+    /// Lowest slot above the given one, or -1 if there is none
+    int next(int slot) const
+    {
+        uint64_t rest = slot < MaxSlots - 1 ? bits & (~0ULL << (slot + 1)) : 0;
+        return rest ? __builtin_ctzll(rest) : -1;
+    }
+};
+
+/// Free voice slots, handed out most recently freed first (so that a
+/// voice that has just finished is the one reused by the next note)
+struct voice_slot_stack {
+    int slots[voice_slot_set::MaxSlots];
+    int count;
+
+    voice_slot_stack() : count(0) {}
+
+    bool empty() const { return count == 0; }
+    void push(int slot) { assert(count < voice_slot_set::MaxSlots); slots[count++] = slot; }
+    /// Remove and return the most recently pushed slot, or -1 if there is none
+    int pop() { return count ? slots[--count] : -1; }
+};
+
 /// Base class for all kinds of polyphonic instruments, provides
 /// somewhat reasonable voice management, pedal support - and 
 /// little else. It's implemented as a base class with virtual
 /// functions, so there's some performance loss, but it shouldn't
-/// be horrible.
+/// be horrible. Synths with a single concrete voice class can avoid
+/// the per-voice dispatch in the audio path with render_block_voices_to.
 /// @todo it would make sense to support all notes off controller too
 struct basic_synth {
 protected:
@@ -284,12 +331,16 @@ protected:
     bool hold;
     /// Sostenuto pedal state
     bool sostenuto;
-    /// All voices available
+    /// All voices available, indexed by slot
     voice_array allocated_voices;
-    /// Voices currently playing
-    voice_array active_voices;
-    /// Voices allocated, but not used
-    voice_array unused_voices;
+    /// Slots of voices currently playing
+    voice_slot_set active_voices;
+    /// Slots of voices allocated, but not used
+    voice_slot_stack unused_voices;
+    /// Order in which the voices in each slot were started, used to pick between voices of the same priority
+    uint32_t voice_serials[voice_slot_set::MaxSlots];
+    /// Serial number of the next voice started
+    uint32_t next_voice_serial;
     /// Gate values for all 128 MIDI notes
     std::bitset<128> gate;
     /// Maximum allocated number of channels
@@ -298,6 +349,85 @@ protected:
     void init_voices(int count);
     void kill_note(int note, int vel, bool just_one);
     virtual dsp::voice *alloc_voice() = 0;
+    /// Take an unused voice slot (stealing if over the polyphony limit), -1 if none
+    int give_voice_slot();
+    dsp::voice **first_active_voice()
+    {
+        int slot = active_voices.first();
+        return slot < 0 ? NULL : allocated_voices.items + slot;
+    }
+    dsp::voice **next_active_voice(dsp::voice **iter)
+    {
+        int slot = active_voices.next(iter - allocated_voices.items);
+        return slot < 0 ? NULL : allocated_voices.items + slot;
+    }
+    /// Move voices that have stopped sounding back to the unused slots, in the
+    /// order they were started, so that the one started last is reused first
+    void free_voices(uint64_t finished)
+    {
+        active_voices.bits &= ~finished;
+        while(finished)
+        {
+            int oldest = __builtin_ctzll(finished);
+            for (uint64_t mask = finished & (finished - 1); mask; mask &= mask - 1)
+            {
+                int slot = __builtin_ctzll(mask);
+                if ((int32_t)(voice_serials[slot] - voice_serials[oldest]) < 0)
+                    oldest = slot;
+            }
+            unused_voices.push(oldest);
+            finished &= ~(1ULL << oldest);
+        }
+    }
+    /// Render all active voices, all of which must be of class block_voice<Voice>.
+    /// Voices that need their next block at the same point are handed to
+    /// Voice::render_blocks together, so that it can run them in SIMD lanes.
+    /// The calls are qualified, so no virtual dispatch is done per voice.
+    template<class Voice>
+    void render_block_voices_to(float (*output)[2], int nsamples)
+    {
+        typedef block_voice<Voice> bvoice;
+        enum { BlockSize = bvoice::BlockSize };
+        bvoice *voices[voice_slot_set::MaxSlots];
+        int count = 0;
+        for (uint64_t mask = active_voices.bits; mask; mask &= mask - 1)
+            voices[count++] = static_cast<bvoice *>(allocated_voices.items[__builtin_ctzll(mask)]);
+        // blocks rendered so far in this call, per offset within a block - all the
+        // voices due at the same point started at the same offset, so they share it
+        int snapshots[BlockSize] = {};
+        int p = 0;
+        while(p < nsamples)
+        {
+            Voice *due[voice_slot_set::MaxSlots];
+            int ndue = 0, snapshot = 0;
+            int ncopy = nsamples - p;
+            for (int i = 0; i < count; i++)
+            {
+                if (voices[i]->read_ptr == BlockSize)
+                {
+                    due[ndue++] = voices[i];
+                    voices[i]->read_ptr = 0;
+                }
+                ncopy = std::min<int>(ncopy, BlockSize - voices[i]->read_ptr);
+            }
+            if (ndue)
+            {
+                snapshot = snapshots[p % BlockSize]++;
+                Voice::render_blocks(due, ndue, snapshot);
+            }
+            for (int i = 0; i < count; i++)
+                voices[i]->mix_to(output + p, ncopy);
+            p += ncopy;
+        }
+        uint64_t finished = 0;
+        for (uint64_t mask = active_voices.bits; mask; mask &= mask - 1)
+        {
+            int slot = __builtin_ctzll(mask);
+            if (!static_cast<bvoice *>(allocated_voices.items[slot])->Voice::get_active())
+                finished |= 1ULL << slot;
+        }
+        free_voices(finished);
+    }
 public:
     virtual void setup(int sr) {
         sample_rate = sr;
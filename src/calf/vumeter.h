@@ -22,9 +22,40 @@
 #define __CALF_VUMETER_H
 
 #include <math.h>
+#include <algorithm>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 namespace dsp {
 
+/// Largest (or, if smallest is set, smallest) absolute value in a buffer of len > 0 samples
+inline float abs_extreme(const float *src, unsigned int len, bool smallest)
+{
+    unsigned int i = 0;
+    float result = fabs(src[0]);
+#if defined(__SSE__)
+    if (len >= 4)
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+        __m128 acc = _mm_andnot_ps(sign, _mm_loadu_ps(src));
+        if (smallest)
+            for (i = 4; i + 4 <= len; i += 4)
+                acc = _mm_min_ps(acc, _mm_andnot_ps(sign, _mm_loadu_ps(src + i)));
+        else
+            for (i = 4; i + 4 <= len; i += 4)
+                acc = _mm_max_ps(acc, _mm_andnot_ps(sign, _mm_loadu_ps(src + i)));
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        result = smallest ? std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]))
+                          : std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+#endif
+    for (; i < len; i++)
+        result = smallest ? std::min(result, (float)fabs(src[i])) : std::max(result, (float)fabs(src[i]));
+    return result;
+}
+
 /// Peak meter class
 struct vumeter
 {
@@ -53,6 +84,7 @@ struct vumeter
     {
         level = reverse ? 1 : 0;
         clip = 0;
+        count_over = 0;
     }
     
     /// Set falloff so that the meter falls 20dB in time_20dB seconds, assuming sample rate of sample_rate
@@ -99,6 +131,27 @@ struct vumeter
         for (unsigned int i = 0; i < len; i++)
             process(src[i]);
     }
+    /// Same as process() for each of len samples of src (NULL for silence). The peak is taken
+    /// with one vector pass, samples are only looked at one by one while the level is above 0dB
+    inline void process_block(const float *src, unsigned int len)
+    {
+        if (!len)
+            return;
+        float value = src ? abs_extreme(src, len, reverse) : 0.f;
+        float new_level = reverse ? std::min(level, value) : std::max(level, value);
+        if (level <= 1.f && new_level <= 1.f)
+        {
+            // the level stays below 0dB for the whole block - nothing to count
+            level = new_level;
+            count_over = 0;
+            return;
+        }
+        if (src)
+            run_sample_loop(src, len);
+        else
+            for (unsigned int i = 0; i < len; i++)
+                process(0.f);
+    }
     inline void process(const float value)
     {
         level = reverse ? std::min(level, (float)fabs(value)) : std::max(level, (float)fabs(value));
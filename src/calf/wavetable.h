@@ -75,6 +75,12 @@ public:
     void channel_pressure(int value);
     void steal();
     void render_block(int current_snapshot);
+    /// Render the next block of several voices (one by one)
+    static void render_blocks(wavetable_voice **voices, int count, int current_snapshot)
+    {
+        for (int i = 0; i < count; i++)
+            voices[i]->render_block(current_snapshot);
+    }
     const int16_t *get_last_table(int osc) const;
     virtual int get_current_note() {
         return note;
@@ -145,9 +151,9 @@ public:
         fill_snapshots(nsamples);
         float buf[MAX_SAMPLE_RUN][2];
         dsp::zero(&buf[0][0], 2 * nsamples);
-        basic_synth::render_to(buf, nsamples);
+        render_block_voices_to<wavetable_voice>(buf, nsamples);
         if (!active_voices.empty())
-            last_voice = (wavetable_voice *)*active_voices.begin();
+            last_voice = (wavetable_voice *)*first_active_voice();
         float gain = 1.0f;
         for (uint32_t i=0; i<nsamples; i++) {
             o[0][i] = gain*buf[i][0];
@@ -40,6 +40,7 @@ host_session::host_session(session_environment_iface *se)
     calfjackhost_cmd = "calfjackhost";
     session_env = se;
     autoconnect_midi_index = -1;
+    internal_chains = false;
     gui_win = NULL;
     session_manager = NULL;
     only_load_if_exists = false;
@@ -276,6 +277,11 @@ void host_session::connect()
                     {
                         fprintf(stderr, "Cannot connect plugins %s and %s - incompatible ports\n", plugins[i - 1]->name.c_str(), plugins[i]->name.c_str());
                     }
+                    else if (internal_chains)
+                    {
+                        if (!client.link_internal(plugins[i - 1], plugins[i]))
+                            fprintf(stderr, "Cannot link plugins %s and %s - the connections would form a cycle\n", plugins[i - 1]->name.c_str(), plugins[i]->name.c_str());
+                    }
                     else {
                         client.connect(cnp + plugins[i - 1]->get_outputs()[0].name, cnp + plugins[i]->get_inputs()[0].name);
                         client.connect(cnp + plugins[i - 1]->get_outputs()[1].name, cnp + plugins[i]->get_inputs()[1].name);
@@ -392,6 +398,8 @@ char *host_session::open_file(const char *name)
                 main_win->refresh_plugin(plugins[i]);
             }
         }
+        for (unsigned int i = 0; i < pl.plugins.size() && i < plugins.size(); i++)
+            link_internal_source(plugins[i], pl.plugins[i].internal_source);
     }
     catch(preset_exception &e)
     {
@@ -447,6 +455,8 @@ char *host_session::save_file(const char *name)
             data << to_xml_attr("output-index", p->get_outputs()[0].name.substr(o_name.length()));
         if (p->get_midi_port())
             data << to_xml_attr("midi-index", p->get_midi_port()->name.substr(m_name.length()));
+        if (p->internal_source)
+            data << to_xml_attr("internal-source", p->internal_source->instance_name);
         data << ">" << endl;
         data << preset.to_xml();
         gather_automation_params gap(data);
@@ -469,10 +479,27 @@ char *host_session::save_file(const char *name)
     return NULL;
 }
 
+void host_session::link_internal_source(jack_host *plugin, const std::string &source)
+{
+    if (source.empty())
+        return;
+    for (unsigned int i = 0; i < plugins.size(); i++)
+    {
+        if (plugins[i]->instance_name == source)
+        {
+            if (!client.link_internal(plugins[i], plugin))
+                fprintf(stderr, "Cannot link %s to %s - the connections would form a cycle\n", plugin->instance_name.c_str(), source.c_str());
+            return;
+        }
+    }
+    fprintf(stderr, "Cannot link %s to %s - no such plugin\n", plugin->instance_name.c_str(), source.c_str());
+}
+
 void host_session::load(session_load_iface *stream)
 {
     // printf("!!!Restore data set!!!\n");
     remove_all_plugins();
+    map<unsigned int, string> internal_sources;
     string key, data;
     while(stream->get_next_item(key, data)) {
         if (key == "global")
@@ -496,6 +523,7 @@ void host_session::load(session_load_iface *stream)
             if (dict.count("input_name")) client.input_nr = atoi(dict["input_name"].c_str());
             if (dict.count("output_name")) client.output_nr = atoi(dict["output_name"].c_str());
             if (dict.count("midi_name")) client.midi_nr = atoi(dict["midi_name"].c_str());
+            if (dict.count("internal_source")) internal_sources[nplugin] = dict["internal_source"];
             preset_list tmp;
             tmp.parse("<presets>"+data+"</presets>", false);
             if (tmp.presets.size())
@@ -509,6 +537,12 @@ void host_session::load(session_load_iface *stream)
             }
         }
     }
+    // sources may come later in the list than the plugins they feed, link_internal reorders them
+    for (map<unsigned int, string>::const_iterator i = internal_sources.begin(); i != internal_sources.end(); ++i)
+    {
+        if (i->first < plugins.size())
+            link_internal_source(plugins[i->first], i->second);
+    }
 }
 
 void host_session::save(session_save_iface *stream)
@@ -540,6 +574,8 @@ void host_session::save(session_save_iface *stream)
             tmp["output_name"] = p->get_outputs()[0].name.substr(o_name.length());
         if (p->get_midi_port())
             tmp["midi_name"] = p->get_midi_port()->name.substr(m_name.length());
+        if (p->internal_source)
+            tmp["internal_source"] = p->internal_source->instance_name;
         tmp["preset"] = pstr;
         dictionary automation;
         gather_automation_params gap(automation);
@@ -586,6 +622,8 @@ void host_session::on_idle()
         quit_on_next_idle_call = -quit_on_next_idle_call; // mark the event as handled but preserve signal number
         session_env->quit_gui_loop();
     }
+    if (client.is_plugin_graph_stale())
+        client.update_plugin_graph();
 }
 
 void host_session::set_signal_handlers()
@@ -20,11 +20,17 @@
  */
 
 #include <stdint.h>
+#include <unistd.h>
 #include <jack/jack.h>
 #include <jack/midiport.h>
 #include <calf/giface.h>
 #include <calf/jackhost.h>
 #include <set>
+#include <algorithm>
+#include <errno.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 using namespace calf_utils;
@@ -39,26 +45,46 @@ jack_client::jack_client()
     sample_rate = 0;
     client = NULL;
     automation_port = NULL;
+    thread_count = 1;
+    snapshot = new jack_plugin_snapshot;
+    rt_cycle = 0;
+    graph_changes = 0;
+    active_workers = 0;
+    workers_quit = false;
+    ready_push = completed = cycle_threads = 0;
+    cycle_snapshot = NULL;
+    cycle_nframes = 0;
+    cycle_automation = NULL;
+}
+
+jack_client::~jack_client()
+{
+    delete snapshot;
 }
 
 void jack_client::add(jack_host *plugin)
 {
     calf_utils::ptlock lock(mutex);
     plugins.push_back(plugin);
+    plugin->rt_owned = true;
+    update_plugin_graph();
 }
 
 void jack_client::del(jack_host *plugin)
 {
     calf_utils::ptlock lock(mutex);
-    for (unsigned int i = 0; i < plugins.size(); i++)
+    std::vector<jack_host *>::iterator i = std::find(plugins.begin(), plugins.end(), plugin);
+    assert(i != plugins.end());
+    for (unsigned int j = 0; j < plugins.size(); j++)
     {
-        if (plugins[i] == plugin)
-        {
-            plugins.erase(plugins.begin()+i);
-            return;
-        }
+        if (plugins[j]->internal_source == plugin)
+            unlink_internal(plugins[j]);
     }
-    assert(0);
+    i = std::find(plugins.begin(), plugins.end(), plugin);
+    plugins.erase(i);
+    // the caller deletes the plugin afterwards, so it must not be referenced by the process callback anymore
+    update_plugin_graph();
+    plugin->rt_owned = false;
 }
 
 void jack_client::open(const char *client_name, const char *jack_session_id)
@@ -71,8 +97,10 @@ void jack_client::open(const char *client_name, const char *jack_session_id)
     if (!client)
         throw calf_utils::text_exception("Could not initialize JACK subsystem");
     sample_rate = jack_get_sample_rate(client);
+    silence.assign(jack_get_buffer_size(client), 0.f);
     jack_set_process_callback(client, do_jack_process, this);
     jack_set_buffer_size_callback(client, do_jack_bufsize, this);
+    jack_set_graph_order_callback(client, do_jack_graph_order, this);
     name = get_name();
 }
 
@@ -84,11 +112,63 @@ std::string jack_client::get_name()
 void jack_client::activate()
 {
     jack_activate(client);        
+    start_workers();
 }
 
 void jack_client::deactivate()
 {
     jack_deactivate(client);        
+    stop_workers();
+}
+
+void jack_client::start_workers()
+{
+    if (thread_count < 2 || !workers.empty())
+        return;
+    // realtime threads of the same priority never time-slice, so there is nothing to gain
+    // (and a lot of latency to lose) from having more of them than there are CPUs
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && thread_count > cpus)
+    {
+        fprintf(stderr, "Warning: only %ld CPUs online, using %ld threads\n", cpus, cpus);
+        thread_count = cpus;
+        if (thread_count < 2)
+            return;
+    }
+    sem_init(&worker_start, 0, 0);
+    sem_init(&plugins_ready, 0, 0);
+    sem_init(&workers_done, 0, 0);
+    workers_quit = false;
+    int priority = jack_client_real_time_priority(client);
+    for (int i = 1; i < thread_count; i++)
+    {
+        jack_native_thread_t thread;
+        if (jack_client_create_thread(client, &thread, priority, jack_is_realtime(client), worker_thread, this) != 0)
+        {
+            fprintf(stderr, "Warning: could not create worker thread, using %d threads\n", i);
+            break;
+        }
+        workers.push_back(thread);
+    }
+    // all the threads exist now, so it is safe to let the process callback use them
+    active_workers = workers.size();
+}
+
+void jack_client::stop_workers()
+{
+    if (workers.empty())
+        return;
+    // JACK is deactivated at this point, so no cycle can be in progress
+    active_workers = 0;
+    workers_quit = true;
+    for (unsigned int i = 0; i < workers.size(); i++)
+        sem_post(&worker_start);
+    for (unsigned int i = 0; i < workers.size(); i++)
+        jack_client_stop_thread(client, workers[i]);
+    workers.clear();
+    sem_destroy(&worker_start);
+    sem_destroy(&plugins_ready);
+    sem_destroy(&workers_done);
 }
 
 void jack_client::connect(const std::string &p1, const std::string &p2)
@@ -97,6 +177,66 @@ void jack_client::connect(const std::string &p1, const std::string &p2)
         throw calf_utils::text_exception("Could not connect JACK ports "+p1+" and "+p2);
 }
 
+bool jack_client::link_internal(jack_host *from, jack_host *to)
+{
+    ptlock lock(mutex);
+    if (from == to)
+        return false;
+    // the source has to run before the plugin it feeds within every cycle, which
+    // may need a new processing order (impossible if to also feeds from)
+    jack_host *old_source = to->internal_source;
+    to->internal_source = from;
+    vector<int> order;
+    calculate_plugin_order(order);
+    int from_index = std::find(plugins.begin(), plugins.end(), from) - plugins.begin();
+    int to_index = std::find(plugins.begin(), plugins.end(), to) - plugins.begin();
+    if (std::find(order.begin(), order.end(), from_index) > std::find(order.begin(), order.end(), to_index))
+    {
+        to->internal_source = old_source;
+        return false;
+    }
+    if (old_source)
+    {
+        // give the inputs their JACK ports back before they are taken over by the new source
+        unlink_internal(to);
+        to->internal_source = from;
+    }
+    apply_plugin_order(order);
+    // from is now processed first, so to can start reading its outputs
+    int count = std::min(from->out_count, to->in_count);
+    for (int i = 0; i < count; i++)
+        to->inputs[i].source = &from->outputs[i];
+    // the process callback must stop using the JACK ports before they are unregistered
+    wait_for_process_cycle();
+    for (int i = 0; i < count; i++)
+    {
+        jack_port_unregister(client, to->inputs[i].handle);
+        to->inputs[i].handle = NULL;
+    }
+    return true;
+}
+
+void jack_client::unlink_internal(jack_host *to)
+{
+    ptlock lock(mutex);
+    if (!to->internal_source)
+        return;
+    for (int i = 0; i < to->in_count; i++)
+    {
+        jack_host::port &p = to->inputs[i];
+        if (!p.source)
+            continue;
+        p.handle = jack_port_register(client, p.nice_name.c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+        if (!p.handle)
+            throw text_exception("Could not create JACK input port");
+        jack_port_set_alias(p.handle, (name + ":" + p.name).c_str());
+        __sync_synchronize();
+        p.source = NULL;
+    }
+    to->internal_source = NULL;
+    update_plugin_graph();
+}
+
 void jack_client::close()
 {
     jack_client_close(client);
@@ -126,11 +266,11 @@ class jack_automation: public automation_iface
         }
     }
 public:
-    jack_automation(jack_port_t *automation_port, int nframes, jack_host *_plugin)
+    jack_automation(void *_midi_data, int nframes, jack_host *_plugin)
     {
         event_pos = 0;
         plugin = _plugin;
-        midi_data = jack_port_get_buffer(automation_port, nframes);
+        midi_data = _midi_data;
         event_count = jack_midi_get_event_count(midi_data NFRAMES_MAYBE(nframes));
     }
     
@@ -138,8 +278,9 @@ public:
     {
         while(event_pos < event_count) {
             jack_midi_event_get(&event, midi_data, event_pos NFRAMES_MAYBE(nframes));
-            if (event.time > start && event.time < time)
-                return event.time;
+            // later events are left for the next call instead of being applied too early
+            if (event.time > start)
+                return event.time < time ? event.time : time;
             event_pos++;
             process_event();
         }
@@ -152,15 +293,147 @@ public:
 int jack_client::do_jack_process(jack_nframes_t nframes, void *p)
 {
     jack_client *self = (jack_client *)p;
-    pttrylock lock(self->mutex);
-    if (lock.is_locked())
+    // full barrier - the snapshot pointer must not be read before the cycle counter is updated
+    __sync_fetch_and_add(&self->rt_cycle, 1);
+    jack_plugin_snapshot *snap = self->snapshot;
+    // fetched once, so that the worker threads don't all ask JACK for the same buffer
+    void *automation_data = jack_port_get_buffer(self->automation_port, nframes);
+    // until the graph is rebuilt after a connection change, the safe thing is to run everything in series
+    if (!self->active_workers || snap->graph_width < 2 || snap->graph_changes != self->graph_changes)
     {
-        for(unsigned int i = 0; i < self->plugins.size(); i++)
+        for(unsigned int i = 0; i < snap->plugins.size(); i++)
         {
-            jack_automation au(self->automation_port, nframes, self->plugins[i]);
-            self->plugins[i]->process(nframes, au);
+            jack_automation au(automation_data, nframes, snap->plugins[i]);
+            snap->plugins[i]->process(nframes, au);
         }
     }
+    else
+        self->process_parallel(snap, nframes, automation_data);
+    __sync_fetch_and_add(&self->rt_cycle, 1);
+    return 0;
+}
+
+/// Wait for a semaphore, spinning for a short while first - the other threads are usually
+/// only a few microseconds away from posting it, but they may be on the same CPU as the caller
+static void wait_for(sem_t *sem)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        if (sem_trywait(sem) == 0)
+            return;
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+    }
+    while(sem_wait(sem) != 0 && errno == EINTR)
+        ;
+}
+
+void jack_client::process_parallel(jack_plugin_snapshot *snap, jack_nframes_t nframes, void *automation_data)
+{
+    int count = snap->plugins.size();
+    int wake = std::min<int>((int)active_workers, snap->graph_width - 1);
+    cycle_snapshot = snap;
+    cycle_nframes = nframes;
+    cycle_automation = automation_data;
+    cycle_threads = wake + 1;
+    ready_push = completed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        snap->pending[i] = snap->dependencies[i];
+        snap->ready[i] = -1;
+    }
+    int initial = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!snap->dependencies[i])
+            snap->ready[initial++] = i;
+    }
+    ready_push = initial;
+    __sync_synchronize();
+    for (int i = 0; i < initial; i++)
+        sem_post(&plugins_ready);
+    for (int i = 0; i < wake; i++)
+        sem_post(&worker_start);
+    run_ready_plugins();
+    // end of cycle barrier - the workers must not touch the cycle state after the callback returns
+    for (int i = 0; i < wake; i++)
+        wait_for(&workers_done);
+}
+
+void jack_client::run_ready_plugins()
+{
+    int count = cycle_snapshot->plugins.size();
+    while(true)
+    {
+        wait_for(&plugins_ready);
+        // the posts made after the last plugin has finished are the ones that end the cycle
+        if (completed == count)
+            break;
+        process_plugin(take_ready_plugin());
+    }
+}
+
+int jack_client::take_ready_plugin()
+{
+    // Every post of plugins_ready is made after the queue slot has been filled, so once the caller
+    // has got one, there is at least one filled slot nobody else has claimed. Slots that are
+    // reserved but not written yet are simply skipped.
+    volatile int *ready_slots = &cycle_snapshot->ready[0];
+    while(true)
+    {
+        int end = ready_push;
+        for (int pos = 0; pos < end; pos++)
+        {
+            int index = ready_slots[pos];
+            if (index >= 0 && __sync_bool_compare_and_swap(&ready_slots[pos], index, -2))
+                return index;
+        }
+    }
+}
+
+void jack_client::process_plugin(int index)
+{
+    jack_plugin_snapshot *snap = cycle_snapshot;
+    jack_automation au(cycle_automation, cycle_nframes, snap->plugins[index]);
+    snap->plugins[index]->process(cycle_nframes, au);
+    const std::vector<int> &next = snap->dependents[index];
+    for (unsigned int i = 0; i < next.size(); i++)
+    {
+        if (!__sync_sub_and_fetch(&snap->pending[next[i]], 1))
+        {
+            int pos = __sync_fetch_and_add(&ready_push, 1);
+            snap->ready[pos] = next[i];
+            sem_post(&plugins_ready);
+        }
+    }
+    if (__sync_add_and_fetch(&completed, 1) == (int)snap->plugins.size())
+    {
+        // wake up every thread of the cycle, so that they all see that there is nothing left to do
+        for (int i = 0; i < cycle_threads; i++)
+            sem_post(&plugins_ready);
+    }
+}
+
+void *jack_client::worker_thread(void *p)
+{
+    jack_client *self = (jack_client *)p;
+    while(true)
+    {
+        if (sem_wait(&self->worker_start) != 0)
+            continue;
+        if (self->workers_quit)
+            break;
+        self->run_ready_plugins();
+        sem_post(&self->workers_done);
+    }
+    return NULL;
+}
+
+int jack_client::do_jack_graph_order(void *p)
+{
+    jack_client *self = (jack_client *)p;
+    __sync_fetch_and_add(&self->graph_changes, 1);
     return 0;
 }
 
@@ -168,6 +441,7 @@ int jack_client::do_jack_bufsize(jack_nframes_t numsamples, void *p)
 {
     jack_client *self = (jack_client *)p;
     ptlock lock(self->mutex);
+    self->silence.assign(numsamples, 0.f);
     for(unsigned int i = 0; i < self->plugins.size(); i++)
         self->plugins[i]->cache_ports();
     return 0;
@@ -176,12 +450,32 @@ int jack_client::do_jack_bufsize(jack_nframes_t numsamples, void *p)
 void jack_client::delete_plugins()
 {
     ptlock lock(mutex);
+    publish_snapshot(new jack_plugin_snapshot);
     for (unsigned int i = 0; i < plugins.size(); i++) {
         delete plugins[i];
     }
     plugins.clear();
 }
 
+void jack_client::publish_snapshot(jack_plugin_snapshot *new_snapshot)
+{
+    jack_plugin_snapshot *old_snapshot = __sync_lock_test_and_set(&snapshot, new_snapshot);
+    wait_for_process_cycle();
+    delete old_snapshot;
+}
+
+void jack_client::wait_for_process_cycle()
+{
+    __sync_synchronize();
+    unsigned int cycle = rt_cycle;
+    // a cycle that started before the change may still be using the old data; cycles starting later can't
+    if (cycle & 1)
+    {
+        while(rt_cycle == cycle)
+            usleep(100);
+    }
+}
+
 void jack_client::create_automation_input()
 {
     automation_port = jack_port_register(client, "Automation MIDI In", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
@@ -195,10 +489,9 @@ void jack_client::destroy_automation_input()
         jack_port_unregister(client, automation_port);
 }
 
-void jack_client::calculate_plugin_order(std::vector<int> &indices)
+void jack_client::get_plugin_connections(std::multimap<int, int> &run_before)
 {
     map<string, int> port_to_plugin;
-    multimap<int, int> run_before;
     for (unsigned int i = 0; i < plugins.size(); i++)
     {
         vector<jack_host::port *> ports;
@@ -233,6 +526,21 @@ void jack_client::calculate_plugin_order(std::vector<int> &indices)
         }
     }
     
+    for (unsigned int i = 0; i < plugins.size(); i++)
+    {
+        if (!plugins[i]->internal_source)
+            continue;
+        int source = std::find(plugins.begin(), plugins.end(), plugins[i]->internal_source) - plugins.begin();
+        if (source < (int)plugins.size())
+            run_before.insert(make_pair((int)i, source));
+    }
+}
+
+void jack_client::calculate_plugin_order(std::vector<int> &indices)
+{
+    multimap<int, int> run_before;
+    get_plugin_connections(run_before);
+    
     struct deptracker
     {
         vector<int> &indices;
@@ -268,11 +576,12 @@ void jack_client::calculate_plugin_order(std::vector<int> &indices)
 void jack_client::apply_plugin_order(const std::vector<int> &indices)
 {
     std::vector<jack_host *> plugins_new;
+    ptlock lock(mutex);
     assert(indices.size() == plugins.size());
     for (unsigned int i = 0; i < indices.size(); i++)
         plugins_new.push_back(plugins[indices[i]]);
-    ptlock lock(mutex);
     plugins.swap(plugins_new);
+    update_plugin_graph();
     
     string s;
     for (unsigned int i = 0; i < plugins.size(); i++)    
@@ -283,3 +592,48 @@ void jack_client::apply_plugin_order(const std::vector<int> &indices)
     }
     printf("Order: %s\n", s.c_str());
 }
+
+void jack_client::update_plugin_graph()
+{
+    ptlock lock(mutex);
+    jack_plugin_snapshot *snap = new jack_plugin_snapshot;
+    snap->graph_changes = graph_changes;
+    snap->plugins = plugins;
+    multimap<int, int> run_before;
+    get_plugin_connections(run_before);
+
+    // Whichever of two connected plugins comes first in the processing order has to finish
+    // before the other one starts. This keeps the results identical to running them in series,
+    // including the one cycle delay when the order is not the signal flow order.
+    int count = plugins.size();
+    vector<int> &new_dependencies = snap->dependencies;
+    vector<vector<int> > &new_dependents = snap->dependents;
+    vector<int> levels(count, 0), level_sizes(count, 0);
+    new_dependencies.resize(count, 0);
+    new_dependents.resize(count);
+    set<pair<int, int> > edges;
+    for (multimap<int, int>::const_iterator i = run_before.begin(); i != run_before.end(); ++i)
+    {
+        if (i->first == i->second)
+            continue;
+        pair<int, int> edge(std::min(i->first, i->second), std::max(i->first, i->second));
+        if (!edges.insert(edge).second)
+            continue;
+        new_dependents[edge.first].push_back(edge.second);
+        new_dependencies[edge.second]++;
+    }
+    int width = 0;
+    for (int i = 0; i < count; i++)
+    {
+        for (unsigned int j = 0; j < new_dependents[i].size(); j++)
+        {
+            int &level = levels[new_dependents[i][j]];
+            level = std::max(level, levels[i] + 1);
+        }
+        width = std::max(width, ++level_sizes[levels[i]]);
+    }
+    snap->graph_width = width;
+    snap->pending.resize(count);
+    snap->ready.resize(count);
+    publish_snapshot(snap);
+}
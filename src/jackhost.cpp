@@ -52,6 +52,8 @@ jack_host::jack_host(jack_client *_client, audio_module_iface *_module, const st
     client = _client;
     cc_mappings = NULL;
     changed = true;
+    rt_owned = false;
+    internal_source = NULL;
 
     module->get_port_arrays(ins, outs, params);
     metadata = module->get_metadata_iface();
@@ -61,6 +63,12 @@ jack_host::jack_host(jack_client *_client, audio_module_iface *_module, const st
     inputs.resize(in_count);
     outputs.resize(out_count);
     param_values = new float[param_count];
+    gui_values.resize(param_count);
+    param_events.resize(param_event_queue_size);
+    param_events_write = param_events_read = 0;
+    gui_events_sent = gui_events_applied = 0;
+    gui_resync = 0;
+    event_origin = 0;
     write_serials.resize(param_count);
     fill(write_serials.begin(), write_serials.end(), 0);
     last_modify_serial = 0;
@@ -148,7 +156,8 @@ void jack_host::rename_ports() {
     for (int i=0; i<in_count; i++) {
         snprintf(buf, sizeof(buf), "%s In #%d", instance_name.c_str(), i+1);
         inputs[i].nice_name = buf;
-        jack_port_rename_fn(client->client, inputs[i].handle, buf);
+        if (inputs[i].handle)
+            jack_port_rename_fn(client->client, inputs[i].handle, buf);
     }
     if (metadata->get_midi()) {
         snprintf(buf, sizeof(buf), "%s MIDI In", instance_name.c_str());
@@ -180,7 +189,9 @@ void jack_host::handle_automation_cc(uint32_t designator, int value)
     {
         const automation_range &r = i->second;
         const parameter_properties *props = metadata->get_param_props(r.param_no);
-        set_param_value(r.param_no, props->from_01(r.min_value + value * (r.max_value - r.min_value)/ 127.0));
+        // called from the process callback, so no need to go through the queue
+        param_values[r.param_no] = props->from_01(r.min_value + value * (r.max_value - r.min_value)/ 127.0);
+        changed = true;
         write_serials[r.param_no] = ++last_modify_serial;
         ++i;
     }
@@ -191,6 +202,86 @@ uint32_t jack_host::get_last_automation_source()
     return last_designator;
 }
 
+float jack_host::get_param_value(int param_no)
+{
+    assert(param_no >= 0 && param_no < param_count);
+    // show the GUI its own changes until the process callback has applied them
+    if ((gui_events_sent != gui_events_applied || gui_resync) && !(metadata->get_param_props(param_no)->flags & PF_PROP_OUTPUT))
+        return gui_values[param_no];
+    return param_values[param_no];
+}
+
+void jack_host::set_param_value(int param_no, float value)
+{
+    assert(param_no >= 0 && param_no < param_count);
+    if (!rt_owned)
+    {
+        param_values[param_no] = gui_values[param_no] = value;
+        changed = true;
+        return;
+    }
+    // nothing in flight - pick up the values changed by automation since the last call
+    if (gui_events_sent == gui_events_applied && !gui_resync)
+        std::copy(param_values, param_values + param_count, gui_values.begin());
+    gui_values[param_no] = value;
+    
+    int pos = param_events_write;
+    int next = (pos + 1) & (param_event_queue_size - 1);
+    if (next == param_events_read)
+    {
+        // queue full - the process callback will copy everything from gui_values instead
+        __sync_synchronize();
+        gui_resync = 1;
+        return;
+    }
+    param_event &event = param_events[pos];
+    event.time = client && client->client ? jack_frame_time(client->client) : 0;
+    event.param_no = param_no;
+    event.value = value;
+    gui_events_sent++;
+    __sync_synchronize();
+    param_events_write = next;
+}
+
+void jack_host::apply_gui_resync()
+{
+    if (!gui_resync)
+        return;
+    __sync_lock_test_and_set(&gui_resync, 0);
+    __sync_synchronize();
+    // the queue is full, and everything in it is older than the values in gui_values
+    int pos = param_events_read, end = param_events_write;
+    int dropped = (end - pos) & (param_event_queue_size - 1);
+    for (int i = 0; i < param_count; i++)
+    {
+        if (!(metadata->get_param_props(i)->flags & PF_PROP_OUTPUT))
+            param_values[i] = gui_values[i];
+    }
+    changed = true;
+    __sync_synchronize();
+    param_events_read = end;
+    __sync_fetch_and_add(&gui_events_applied, dropped);
+}
+
+uint32_t jack_host::apply_param_events(uint32_t start, uint32_t end)
+{
+    while(param_events_read != param_events_write)
+    {
+        __sync_synchronize();
+        int pos = param_events_read;
+        const param_event &event = param_events[pos];
+        int32_t offset = (int32_t)(event.time - event_origin);
+        if (offset > (int32_t)start)
+            return offset < (int32_t)end ? offset : end;
+        param_values[event.param_no] = event.value;
+        changed = true;
+        __sync_synchronize();
+        param_events_read = (pos + 1) & (param_event_queue_size - 1);
+        __sync_fetch_and_add(&gui_events_applied, 1);
+    }
+    return end;
+}
+
 
 void jack_host::handle_event(uint8_t *buffer, uint32_t size)
 {
@@ -228,7 +319,8 @@ void jack_host::destroy()
     port *inputs = get_inputs(), *outputs = get_outputs();
     int input_count = metadata->get_input_count(), output_count = metadata->get_output_count();
     for (int i = 0; i < input_count; i++) {
-        jack_port_unregister(client->client, inputs[i].handle);
+        if (inputs[i].handle)
+            jack_port_unregister(client->client, inputs[i].handle);
         inputs[i].data = NULL;
     }
     for (int i = 0; i < output_count; i++) {
@@ -244,6 +336,10 @@ void jack_host::process_part(unsigned int time, unsigned int len)
 {
     if (!len)
         return;
+    if (changed) {
+        module->params_changed();
+        changed = false;
+    }
     for (int i = 0; i < in_count; i++)
         inputs[i].meter.update(ins[i] + time, len);
     unsigned int mask = module->process_slice(time, time + len);
@@ -277,15 +373,20 @@ float jack_host::get_level(unsigned int port)
 
 int jack_host::process(jack_nframes_t nframes, automation_iface &automation)
 {
+    dsp::denormal_guard denormals;
     for (int i=0; i<in_count; i++) {
-        ins[i] = inputs[i].data = (float *)jack_port_get_buffer(inputs[i].handle, nframes);
+        // internally linked inputs use the output buffer of the source plugin as is
+        port *source = inputs[i].source;
+        if (!source)
+            ins[i] = inputs[i].data = (float *)jack_port_get_buffer(inputs[i].handle, nframes);
+        else
+            ins[i] = inputs[i].data = source->data ? source->data : &client->silence[0];
     }
     if (metadata->get_midi())
         midi_port.data = (float *)jack_port_get_buffer(midi_port.handle, nframes);
-    if (changed) {
-        module->params_changed();
-        changed = false;
-    }
+    // events queued during the previous cycle are played back with one period of latency, which keeps their spacing
+    event_origin = jack_last_frame_time(client->client) - nframes;
+    apply_gui_resync();
 
     unsigned int time = 0;
     if (metadata->get_midi())
@@ -295,9 +396,7 @@ int jack_host::process(jack_nframes_t nframes, automation_iface &automation)
         for (int i = 0; i < count; i++)
         {
             jack_midi_event_get(&event, midi_port.data, i NFRAMES_MAYBE(nframes));
-            uint32_t endtime = automation.apply_and_adjust(time, event.time);
-            unsigned int len = endtime - time;
-            process_part(time, len);
+            process_until(time, event.time, automation);
             
             midi_meter = 1.f;
             handle_event(event.buffer, event.size);
@@ -305,14 +404,21 @@ int jack_host::process(jack_nframes_t nframes, automation_iface &automation)
             time = event.time;
         }
     }
-    while(time < nframes)
+    process_until(time, nframes, automation);
+    module->params_reset();
+    return 0;
+}
+
+void jack_host::process_until(unsigned int time, unsigned int end, automation_iface &automation)
+{
+    while(time < end)
     {
-        uint32_t endtime = automation.apply_and_adjust(time, nframes);
+        uint32_t endtime = apply_param_events(time, automation.apply_and_adjust(time, end));
         process_part(time, endtime - time);
         time = endtime;
     }
-    module->params_reset();
-    return 0;
+    // changes due exactly at the end take effect before the next MIDI event
+    apply_param_events(end, end);
 }
 
 void jack_host::init_module()
@@ -417,7 +523,7 @@ char *jack_host::configure(const char *key, const char *value)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static const char *short_options = "c:i:l:o:m:M:s:S:ehvL";
+static const char *short_options = "c:i:l:o:m:M:s:S:t:ehvLI";
 
 static struct option long_options[] = {
     {"help", 0, 0, 'h'},
@@ -432,6 +538,8 @@ static struct option long_options[] = {
     {"connect-midi", 1, 0, 'M'},
     {"session-id", 1, 0, 'S'},
     {"list", 0, 0, 'L'},
+    {"threads", 1, 0, 't'},
+    {"internal", 0, 0, 'I'},
     {0,0,0,0},
 };
 
@@ -439,7 +547,7 @@ void print_help(char *argv[])
 {
     printf("JACK host for Calf effects\n"
         "Syntax: %s [--client <name>] [--input <name>] [--output <name>] [--midi <name>] [--load|state <session>]\n"
-        "       [--connect-midi <name|capture-index>] [--help] [--version] [--list] [!] pluginname[:<preset>] [!] ...\n", 
+        "       [--connect-midi <name|capture-index>] [--threads <count>] [--internal] [--help] [--version] [--list] [!] pluginname[:<preset>] [!] ...\n", 
         argv[0]);
 }
 
@@ -534,6 +642,12 @@ int main(int argc, char *argv[])
                 else
                     sess.autoconnect_midi = string(optarg);
                 break;
+            case 't':
+                sess.client.thread_count = std::max(1, atoi(optarg));
+                break;
+            case 'I':
+                sess.internal_chains = true;
+                break;
             case 'L':
                 string s = 
                 #define PER_MODULE_ITEM(name, isSynth, jackname) jackname " "
@@ -139,6 +139,7 @@ void lv2_instance::output_event_property(const char *key, const char *value)
 
 void lv2_instance::run(uint32_t SampleCount, bool has_simulate_stereo_input_flag)
 {
+    dsp::denormal_guard denormals;
     if (set_srate) {
         module->set_sample_rate(srate_to_set);
         module->activate();
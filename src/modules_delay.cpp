@@ -71,10 +71,11 @@ void reverb_audio_module::params_changed()
 
 uint32_t reverb_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
+    float dry[MAX_SAMPLE_RUN], wet[MAX_SAMPLE_RUN];
+    dryamount.fill_block(dry, numsamples);
+    amount.fill_block(wet, numsamples);
     numsamples += offset;
     for (uint32_t i = offset; i < numsamples; i++) {
-        float dry = dryamount.get();
-        float wet = amount.get();
         stereo_sample<float> s(ins[0][i] * *params[param_level_in],
                                ins[1][i] * *params[param_level_in]);
         stereo_sample<float> s2 = pre_delay.process(s, predelay_amt);
@@ -84,11 +85,11 @@ uint32_t reverb_audio_module::process(uint32_t offset, uint32_t numsamples, uint
         rr = right_lo.process(right_hi.process(rr));
         if (*params[par_on] > 0.5)
             reverb.process(rl, rr);
-        outs[0][i] = dry*s.left;
-        outs[1][i] = dry*s.right;
+        outs[0][i] = dry[i - offset]*s.left;
+        outs[1][i] = dry[i - offset]*s.right;
         if (*params[par_on] > 0.5) {
-            outs[0][i] += wet*rl;
-            outs[1][i] += wet*rr;
+            outs[0][i] += wet[i - offset]*rl;
+            outs[1][i] += wet[i - offset]*rr;
         }
         outs[0][i] *= *params[param_level_out];
         outs[1][i] *= *params[param_level_out];
@@ -193,6 +194,16 @@ void vintage_delay_audio_module::params_changed()
         calc_filters();
 }
 
+int vintage_delay_audio_module::get_tail_length()
+{
+    // number of trips around the feedback loop needed to get to -100 dB
+    float fb = std::max(fb_left.old_value, fb_right.old_value);
+    if (fb >= 0.99f)
+        return -1;
+    int loops = fb > 0.f ? (int)ceil(log(0.00001f) / log(fb)) : 0;
+    return (loops + 1) * (deltime_l + deltime_r) + srate / 10;
+}
+
 void vintage_delay_audio_module::activate()
 {
     bufptr = 0;
@@ -226,37 +237,33 @@ void vintage_delay_audio_module::calc_filters()
 }
 
 /// Single delay line with feedback at the same tap
-static inline void delayline_impl(int age, int deltime, float dry_value, const float &delayed_value, float &out, float &del, gain_smoothing &amt, gain_smoothing &fb)
+static inline void delayline_impl(int age, int deltime, float dry_value, const float &delayed_value, float &out, float &del, float amt, float fb)
 {
     // if the buffer hasn't been cleared yet (after activation), pretend we've read zeros
     if (age <= deltime) {
         out = 0;
         del = dry_value;
-        amt.step();
-        fb.step();
     }
     else
     {
         float delayed = delayed_value; // avoid dereferencing the pointer in 'then' branch of the if()
         dsp::sanitize(delayed);
-        out = delayed * amt.get();
-        del = dry_value + delayed * fb.get();
+        out = delayed * amt;
+        del = dry_value + delayed * fb;
     }
 }
 
 /// Single delay line with tap output
-static inline void delayline2_impl(int age, int deltime, float dry_value, const float &delayed_value, const float &delayed_value_for_fb, float &out, float &del, gain_smoothing &amt, gain_smoothing &fb)
+static inline void delayline2_impl(int age, int deltime, float dry_value, const float &delayed_value, const float &delayed_value_for_fb, float &out, float &del, float amt, float fb)
 {
     if (age <= deltime) {
         out = 0;
         del = dry_value;
-        amt.step();
-        fb.step();
     }
     else
     {
-        out = delayed_value * amt.get();
-        del = dry_value + delayed_value_for_fb * fb.get();
+        out = delayed_value * amt;
+        del = dry_value + delayed_value_for_fb * fb;
         dsp::sanitize(out);
         dsp::sanitize(del);
     }
@@ -276,6 +283,14 @@ uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsample
     uint32_t end = offset + numsamples;
     int orig_bufptr = bufptr;
     float out_left, out_right, del_left, del_right, inL, inR;
+    // smoothed gains for the whole block
+    float amtL[MAX_SAMPLE_RUN], amtR[MAX_SAMPLE_RUN], fbL[MAX_SAMPLE_RUN], fbR[MAX_SAMPLE_RUN], dryv[MAX_SAMPLE_RUN], chmixv[MAX_SAMPLE_RUN];
+    amt_left.fill_block(amtL, numsamples);
+    amt_right.fill_block(amtR, numsamples);
+    fb_left.fill_block(fbL, numsamples);
+    fb_right.fill_block(fbR, numsamples);
+    dry.fill_block(dryv, numsamples);
+    chmix.fill_block(chmixv, numsamples);
     
     switch(mixmode)
     {
@@ -287,9 +302,10 @@ uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsample
             {       
                 inL = ins[0][i] * *params[param_level_in];
                 inR = ins[1][i] * *params[param_level_in];
-                delayline_impl(age, deltime_l, *params[param_on] > 0.5 ? inL : 0, buffers[v][(bufptr - deltime_l) & ADDR_MASK], out_left, del_left, amt_left, fb_left);
-                delayline_impl(age, deltime_r, *params[param_on] > 0.5 ? inR : 0, buffers[1 - v][(bufptr - deltime_r) & ADDR_MASK], out_right, del_right, amt_right, fb_right);
-                delay_mix(inL, inR, out_left, out_right, dry.get(), chmix.get());
+                uint32_t j = i - offset;
+                delayline_impl(age, deltime_l, *params[param_on] > 0.5 ? inL : 0, buffers[v][(bufptr - deltime_l) & ADDR_MASK], out_left, del_left, amtL[j], fbL[j]);
+                delayline_impl(age, deltime_r, *params[param_on] > 0.5 ? inR : 0, buffers[1 - v][(bufptr - deltime_r) & ADDR_MASK], out_right, del_right, amtR[j], fbR[j]);
+                delay_mix(inL, inR, out_left, out_right, dryv[j], chmixv[j]);
                 
                 age++;
                 outs[0][i] = out_left * *params[param_level_out];
@@ -314,9 +330,10 @@ uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsample
             {
                 inL = ins[0][i] * *params[param_level_in];
                 inR = ins[1][i] * *params[param_level_in];
-                delayline2_impl(age, deltime_l, *params[param_on] > 0.5 ? inL : 0, buffers[v][(bufptr - deltime_l_corr) & ADDR_MASK], buffers[v][(bufptr - deltime_fb) & ADDR_MASK], out_left, del_left, amt_left, fb_left);
-                delayline2_impl(age, deltime_r, *params[param_on] > 0.5 ? inR : 0, buffers[1 - v][(bufptr - deltime_r_corr) & ADDR_MASK], buffers[1-v][(bufptr - deltime_fb) & ADDR_MASK], out_right, del_right, amt_right, fb_right);
-                delay_mix(inL, inR, out_left, out_right, dry.get(), chmix.get());
+                uint32_t j = i - offset;
+                delayline2_impl(age, deltime_l, *params[param_on] > 0.5 ? inL : 0, buffers[v][(bufptr - deltime_l_corr) & ADDR_MASK], buffers[v][(bufptr - deltime_fb) & ADDR_MASK], out_left, del_left, amtL[j], fbL[j]);
+                delayline2_impl(age, deltime_r, *params[param_on] > 0.5 ? inR : 0, buffers[1 - v][(bufptr - deltime_r_corr) & ADDR_MASK], buffers[1-v][(bufptr - deltime_fb) & ADDR_MASK], out_right, del_right, amtR[j], fbR[j]);
+                delay_mix(inL, inR, out_left, out_right, dryv[j], chmixv[j]);
                 
                 age++;
                 outs[0][i] = out_left * *params[param_level_out];
@@ -432,7 +449,6 @@ uint32_t comp_delay_audio_module::process(uint32_t offset, uint32_t numsamples,
     uint32_t off    = offset;
     
     if (bypassed) {
-        float values[] = {0,0,0,0};
         while(offset < end) {
             outs[0][offset] = ins[0][offset];
             buffer[w_ptr]   = ins[0][offset];
@@ -441,33 +457,33 @@ uint32_t comp_delay_audio_module::process(uint32_t offset, uint32_t numsamples,
                 buffer[w_ptr + 1] = ins[1][offset];
             }
             w_ptr = (w_ptr + 2) & b_mask;
-            meters.process(values);
             ++offset;
         }
+        const float *values[] = {NULL, NULL, NULL, NULL};
+        meters.process(values, numsamples);
     } else {
         uint32_t r_ptr  = (write_ptr + buf_size - delay) & b_mask; // Unsigned math, that's why we add buf_size
         float dry       = *params[par_dry];
         float wet       = *params[par_wet];
-        float L = 0, R = 0;
+        float level_in  = *params[param_level_in];
+        float level_out = *params[param_level_out];
+        float inL[MAX_SAMPLE_RUN], inR[MAX_SAMPLE_RUN];
         
         for (uint32_t i=offset; i<end; i++)
         {
-            L = ins[0][i] * *params[param_level_in];
+            float L = inL[i - offset] = ins[0][i] * level_in;
             buffer[w_ptr] = L;
-            outs[0][i] = dry * L + wet * buffer[r_ptr];
-            outs[0][i] *= *params[param_level_out];
+            outs[0][i] = (dry * L + wet * buffer[r_ptr]) * level_out;
             if (stereo) {
-                R = ins[1][i] * *params[param_level_in];
+                float R = inR[i - offset] = ins[1][i] * level_in;
                 buffer[w_ptr + 1] = R;
-                outs[1][i] = dry * R + wet * buffer[r_ptr + 1];
-                outs[1][i] *= *params[param_level_out];
+                outs[1][i] = (dry * R + wet * buffer[r_ptr + 1]) * level_out;
             }
             w_ptr = (w_ptr + 2) & b_mask;
             r_ptr = (r_ptr + 2) & b_mask;
-            
-            float values[] = {L, R, outs[0][i], outs[1][i]};
-            meters.process(values);
         }
+        const float *values[] = {inL, stereo ? inR : NULL, outs[0] + off, stereo ? outs[1] + off : NULL};
+        meters.process(values, numsamples);
     }
     if (!bypassed)
         bypass.crossfade(ins, outs, stereo ? 2 : 1, off, numsamples);
@@ -721,6 +737,11 @@ uint32_t reverse_delay_audio_module::process(uint32_t offset, uint32_t numsample
     bool bypassed  = bypass.update(*params[param_bypass] > 0.5f, numsamples);
     uint32_t ostate = 3; // XXXKF optimize!
     uint32_t end = offset + numsamples;
+    // smoothed parameters for the whole block
+    float fbv[MAX_SAMPLE_RUN], widthv[MAX_SAMPLE_RUN], dryv[MAX_SAMPLE_RUN];
+    fb_val.fill_block(fbv, numsamples);
+    width.fill_block(widthv, numsamples);
+    dry.fill_block(dryv, numsamples);
 
     //Loop
     for(uint32_t i = offset; i < end; i++)
@@ -738,11 +759,12 @@ uint32_t reverse_delay_audio_module::process(uint32_t offset, uint32_t numsample
         //Process
         float inL = 0., inR = 0., outL = 0., outR = 0.;
         if (bypassed) {
-            outs[0][offset] = ins[0][offset];
-            outs[1][offset] = ins[1][offset];
+            outs[0][i] = ins[0][i];
+            outs[1][i] = ins[1][i];
         } else {
-            float feedback_val = fb_val.get();
-            float st_width_val = width.get();
+            float feedback_val = fbv[i - offset];
+            float st_width_val = widthv[i - offset];
+            float dry_val = dryv[i - offset];
     
             inL = ins[0][i] + st_width_val*ins[1][i];
             inR = ins[1][i]*(1 - st_width_val);
@@ -760,16 +782,17 @@ uint32_t reverse_delay_audio_module::process(uint32_t offset, uint32_t numsample
             outL *= ow[0].get();
             outR *= ow[1].get();
     
-            outL = outL * (1 + dry.get()) + inL*(1 - dry.get());
-            outR = outR * (1 + dry.get()) + inR*(1 - dry.get());
+            outL = outL * (1 + dry_val) + inL*(1 - dry_val);
+            outR = outR * (1 + dry_val) + inR*(1 - dry_val);
     
             outs[0][i] = outL * *params[param_level_out];
             outs[1][i] = outR * *params[param_level_out];
-            bypass.crossfade(ins, outs, 2, offset, numsamples);
         }
         float values[] = {inL, inR, outL, outR};
         meters.process(values);
     }
+    if (!bypassed)
+        bypass.crossfade(ins, outs, 2, offset, numsamples);
     meters.fall(numsamples);
     return ostate;
 }
@@ -49,6 +49,8 @@ saturator_audio_module::saturator_audio_module()
 void saturator_audio_module::activate()
 {
     is_active = true;
+    dry_delay[0].reset();
+    dry_delay[1].reset();
     // set all filters
     params_changed();
 }
@@ -146,6 +148,7 @@ uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, u
     } else {
         uint32_t orig_numsamples = numsamples-offset;
         uint32_t orig_offset = offset;
+        int latency = dist[0].get_latency();
         // process
         while(offset < numsamples) {
             // cycle through samples
@@ -165,6 +168,14 @@ uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, u
                 c = 1;
             }
             
+            // the oversampled distortion delays the processed signal,
+            // the dry one has to be delayed by the same amount
+            float dry[2] = { in[0], in[1] };
+            if (latency) {
+                dry[0] = dry_delay[0].process(in[0], latency);
+                dry[1] = dry_delay[1].process(in[1], latency);
+            }
+            
             float proc[2];
             proc[0] = in[0] * *params[param_level_in];
             proc[1] = in[1] * *params[param_level_in];
@@ -197,20 +208,20 @@ uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, u
             
             if(in_count > 1 && out_count > 1) {
                 // full stereo
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((proc[0] * *params[param_mix]) + dry[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
-                out[1] = ((proc[1] * *params[param_mix]) + in[1] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[1] = ((proc[1] * *params[param_mix]) + dry[1] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[1][offset] = out[1];
             } else if(out_count > 1) {
                 // mono -> pseudo stereo
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((proc[0] * *params[param_mix]) + dry[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 out[1] = out[0];
                 outs[1][offset] = out[1];
             } else {
                 // stereo -> mono
                 // or full mono
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((proc[0] * *params[param_mix]) + dry[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
             }
             float values[] = {in[0],  in[1], out[0], out[1]};
@@ -262,6 +273,8 @@ exciter_audio_module::exciter_audio_module()
 void exciter_audio_module::activate()
 {
     is_active = true;
+    dry_delay[0].reset();
+    dry_delay[1].reset();
     // set all filters
     params_changed();
 }
@@ -340,6 +353,7 @@ uint32_t exciter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
     } else {
         uint32_t orig_numsamples = numsamples-offset;
         uint32_t orig_offset = offset;
+        int latency = dist[0].get_latency();
         meter_drive = 0.f;
         
         float in2out = *params[param_listen] > 0.f ? 0.f : 1.f;
@@ -368,6 +382,14 @@ uint32_t exciter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
                 c = 1;
             }
             
+            // the oversampled distortion delays the processed signal,
+            // the dry one has to be delayed by the same amount
+            float dry[2] = { in[0], in[1] };
+            if (latency) {
+                dry[0] = dry_delay[0].process(in[0], latency);
+                dry[1] = dry_delay[1].process(in[1], latency);
+            }
+            
             float proc[2];
             proc[0] = in[0];
             proc[1] = in[1];
@@ -393,19 +415,19 @@ uint32_t exciter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
             if(in_count > 1 && out_count > 1) {
                 maxDrive = std::max(maxDrive, dist[1].get_distortion_level() * *params[param_amount]);
                 // full stereo
-                out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
-                out[1] = (proc[1] * *params[param_amount] + in2out * in[1]) * *params[param_level_out];
+                out[0] = (proc[0] * *params[param_amount] + in2out * dry[0]) * *params[param_level_out];
+                out[1] = (proc[1] * *params[param_amount] + in2out * dry[1]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 outs[1][offset] = out[1];
             } else if(out_count > 1) {
                 // mono -> pseudo stereo
-                out[1] = out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
+                out[1] = out[0] = (proc[0] * *params[param_amount] + in2out * dry[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 outs[1][offset] = out[1];
             } else {
                 // stereo -> mono
                 // or full mono
-                out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
+                out[0] = (proc[0] * *params[param_amount] + in2out * dry[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
             }
             float values[] = {(in[0] + in[1]) / 2, (out[0] + out[1]) / 2, maxDrive};
@@ -450,6 +472,8 @@ bassenhancer_audio_module::bassenhancer_audio_module()
 void bassenhancer_audio_module::activate()
 {
     is_active = true;
+    dry_delay[0].reset();
+    dry_delay[1].reset();
     // set all filters
     params_changed();
 }
@@ -526,6 +550,7 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
         // process
         uint32_t orig_numsamples = numsamples-offset;
         uint32_t orig_offset = offset;
+        int latency = dist[0].get_latency();
         while(offset < numsamples) {
             // cycle through samples
             float out[2], in[2] = {0.f, 0.f};
@@ -549,6 +574,14 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
                 c = 1;
             }
             
+            // the oversampled distortion delays the processed signal,
+            // the dry one has to be delayed by the same amount
+            float dry[2] = { in[0], in[1] };
+            if (latency) {
+                dry[0] = dry_delay[0].process(in[0], latency);
+                dry[1] = dry_delay[1].process(in[1], latency);
+            }
+            
             float proc[2];
             proc[0] = in[0];
             proc[1] = in[1];
@@ -575,12 +608,12 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
                 if(*params[param_listen] > 0.f)
                     out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
                 else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                    out[0] = (proc[0] * *params[param_amount] + dry[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 if(*params[param_listen] > 0.f)
                     out[1] = proc[1] * *params[param_amount] * *params[param_level_out];
                 else
-                    out[1] = (proc[1] * *params[param_amount] + in[1]) * *params[param_level_out];
+                    out[1] = (proc[1] * *params[param_amount] + dry[1]) * *params[param_level_out];
                 outs[1][offset] = out[1];
                 maxDrive = std::max(dist[0].get_distortion_level() * *params[param_amount],
                                             dist[1].get_distortion_level() * *params[param_amount]);
@@ -589,7 +622,7 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
                 if(*params[param_listen] > 0.f)
                     out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
                 else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                    out[0] = (proc[0] * *params[param_amount] + dry[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 out[1] = out[0];
                 outs[1][offset] = out[1];
@@ -600,7 +633,7 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
                 if(*params[param_listen] > 0.f)
                     out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
                 else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                    out[0] = (proc[0] * *params[param_amount] + dry[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 maxDrive = dist[0].get_distortion_level() * *params[param_amount];
             }
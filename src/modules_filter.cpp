@@ -53,6 +53,8 @@ equalizerNband_audio_module<BaseClass, has_lphp>::equalizerNband_audio_module()
     hs_freq_old = ls_freq_old = lp_q_old = 0;
     hs_level_old = ls_level_old = 0;
     keep_gliding = 0;
+    glide_steps = 1;
+    stage_count = 0;
     last_peak = 0;
     indiv_old = -1;
     analyzer_old = false;
@@ -89,15 +91,15 @@ static inline void copy_lphp(biquad_d2 filters[3][2])
                 filters[i][j].copy_coeffs(filters[0][0]);
 }
 
-static inline double glide(double value, double target, int &keep_gliding)
+static inline double glide(double value, double target, int &keep_gliding, float steps)
 {
     if (target == value)
         return value;
     keep_gliding = 1;
     if (target > value)
-        return std::min(target, (value + 0.1) * 1.003);
+        return std::min(target, (value + 0.1 * steps) * pow(1.003, steps));
     else
-        return std::max(target, (value / 1.003) - 0.1);
+        return std::max(target, (value / pow(1.003, steps)) - 0.1 * steps);
 }
 
 template<class BaseClass, bool has_lphp>
@@ -116,13 +118,13 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
         float hpq = *params[AM::param_hp_q], lpq = *params[AM::param_lp_q];
         
         if(hpfreq != hp_freq_old or hpq != hp_q_old) {
-            hpfreq = glide(hp_freq_old, hpfreq, keep_gliding);
+            hpfreq = glide(hp_freq_old, hpfreq, keep_gliding, glide_steps);
             hp[0][0].set_hp_rbj(hpfreq, hpq, (float)srate, 1.0);
             copy_lphp(hp);
             hp_freq_old = hpfreq;
         }
         if(lpfreq != lp_freq_old or lpq != lp_q_old) {
-            lpfreq = glide(lp_freq_old, lpfreq, keep_gliding);
+            lpfreq = glide(lp_freq_old, lpfreq, keep_gliding, glide_steps);
             lp[0][0].set_lp_rbj(lpfreq, lpq, (float)srate, 1.0);
             copy_lphp(lp);
             lp_freq_old = lpfreq;
@@ -134,7 +136,7 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
     float lsfreq = *params[AM::param_ls_freq], lslevel = *params[AM::param_ls_level], lsq =*params[AM::param_ls_q];
     
     if(lsfreq != ls_freq_old or lslevel != ls_level_old or lsq != ls_q_old) {
-        lsfreq = glide(ls_freq_old, lsfreq, keep_gliding);
+        lsfreq = glide(ls_freq_old, lsfreq, keep_gliding, glide_steps);
         lsL.set_lowshelf_rbj(lsfreq, lsq, lslevel, (float)srate);
         lsR.copy_coeffs(lsL);
         ls_level_old = lslevel;
@@ -142,7 +144,7 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
         ls_q_old = lsq;
     }
     if(hsfreq != hs_freq_old or hslevel != hs_level_old or hsq != hs_q_old) {
-        hsfreq = glide(hs_freq_old, hsfreq, keep_gliding);
+        hsfreq = glide(hs_freq_old, hsfreq, keep_gliding, glide_steps);
         hsL.set_highshelf_rbj(hsfreq, hsq, hslevel, (float)srate);
         hsR.copy_coeffs(hsL);
         hs_level_old = hslevel;
@@ -156,7 +158,7 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
         float level = *params[AM::param_p1_level + offset];
         float q = *params[AM::param_p1_q + offset];
         if(freq != p_freq_old[i] or level != p_level_old[i] or q != p_q_old[i]) {
-            freq = glide(p_freq_old[i], freq, keep_gliding);
+            freq = glide(p_freq_old[i], freq, keep_gliding, glide_steps);
             pL[i].set_peakeq_rbj(freq, q, level, (float)srate);
             pR[i].copy_coeffs(pL[i]);
             p_freq_old[i] = freq;
@@ -164,6 +166,8 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
             p_q_old[i] = q;
         }
     }
+    build_stages();
+    
     if (*params[AM::param_individuals] != indiv_old) {
         indiv_old = *params[AM::param_individuals];
         redraw_graph = true;
@@ -189,64 +193,34 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
 }
 
 template<class BaseClass, bool has_lphp>
-inline void equalizerNband_audio_module<BaseClass, has_lphp>::process_hplp(float &left, float &right)
+void equalizerNband_audio_module<BaseClass, has_lphp>::add_stage(biquad_d2 *left, biquad_d2 *right, int route)
 {
-    if (!has_lphp)
+    if (route < 1 or route > 5)
         return;
-    int active = *params[AM::param_lp_active];
-    if (active > 0.f)
-    {
-        if (active > 3) diff_ms(left, right);
-        switch(lp_mode)
-        {
-            case MODE12DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = lp[0][0].process(left);
-                if (active == 1 or active == 3 or active == 5)
-                    right = lp[0][1].process(right);
-                break;
-            case MODE24DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = lp[1][0].process(lp[0][0].process(left));
-                if (active == 1 or active == 3 or active == 5)
-                    right = lp[1][1].process(lp[0][1].process(right));
-                break;
-            case MODE36DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = lp[2][0].process(lp[1][0].process(lp[0][0].process(left)));
-                if (active == 1 or active == 3 or active == 5)
-                    right = lp[2][1].process(lp[1][1].process(lp[0][1].process(right)));
-                break;
-        }
-        if (active > 3) undiff_ms(left, right);
-    }
-    active = *params[AM::param_hp_active];
-    if (active > 0.f)
+    eq_stage &stage = stages[stage_count++];
+    stage.left = left;
+    stage.right = right;
+    stage.route = route;
+}
+
+template<class BaseClass, bool has_lphp>
+void equalizerNband_audio_module<BaseClass, has_lphp>::build_stages()
+{
+    // flatten the chain into the filters that are actually in use, in processing order
+    stage_count = 0;
+    if (has_lphp)
     {
-        if (active > 3) diff_ms(left, right);
-        switch(hp_mode)
-        {
-            case MODE12DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = hp[0][0].process(left);
-                if (active == 1 or active == 3 or active == 5)
-                    right = hp[0][1].process(right);
-                break;
-            case MODE24DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = hp[1][0].process(hp[0][0].process(left));
-                if (active == 1 or active == 3 or active == 5)
-                    right = hp[1][1].process(hp[0][1].process(right));
-                break;
-            case MODE36DB:
-                if (active == 1 or active == 2 or active == 4)
-                    left = hp[2][0].process(hp[1][0].process(hp[0][0].process(left)));
-                if (active == 1 or active == 3 or active == 5)
-                    right = hp[2][1].process(hp[1][1].process(hp[0][1].process(right)));
-                break;
-        }
-        if (active > 3) undiff_ms(left, right);
+        int active = *params[AM::param_lp_active];
+        for (int i = 0; i <= (int)lp_mode; i++)
+            add_stage(&lp[i][0], &lp[i][1], active);
+        active = *params[AM::param_hp_active];
+        for (int i = 0; i <= (int)hp_mode; i++)
+            add_stage(&hp[i][0], &hp[i][1], active);
     }
+    add_stage(&lsL, &lsR, *params[AM::param_ls_active]);
+    add_stage(&hsL, &hsR, *params[AM::param_hs_active]);
+    for (int i = 0; i < AM::PeakBands; i++)
+        add_stage(&pL[i], &pR[i], *params[AM::param_p1_active + i * params_per_band]);
 }
 
 template<class BaseClass, bool has_lphp>
@@ -255,17 +229,11 @@ uint32_t equalizerNband_audio_module<BaseClass, has_lphp>::process(uint32_t offs
     bool bypassed = bypass.update(*params[AM::param_bypass] > 0.5f, numsamples);
     if (keep_gliding)
     {
-        // ensure that if params have changed, the params_changed method is
-        // called every 8 samples to interpolate filter parameters
-        while(numsamples > 8 && keep_gliding)
-        {
-            params_changed();
-            outputs_mask |= process(offset, 8, inputs_mask, outputs_mask);
-            offset += 8;
-            numsamples -= 8;
-        }
-        if (keep_gliding)
-            params_changed();
+        // move the gliding filters on once per block, at the same speed as the
+        // old 8 sample slicing (which took two glide steps per slice)
+        glide_steps = numsamples / 4.f;
+        params_changed();
+        glide_steps = 1;
     }
     numsamples += offset;
     if(bypassed) {
@@ -282,52 +250,55 @@ uint32_t equalizerNband_audio_module<BaseClass, has_lphp>::process(uint32_t offs
         // process
         uint32_t orig_numsamples = numsamples-offset;
         uint32_t orig_offset = offset;
-        while(offset < numsamples) {
-            // cycle through samples
-            float outL = 0.f;
-            float outR = 0.f;
-            float inL = ins[0][offset];
-            float inR = ins[1][offset];
-            // in level
-            inR *= *params[AM::param_level_in];
-            inL *= *params[AM::param_level_in];
-            
-            float procL = inL;
-            float procR = inR;
-            
-            // all filters in chain
-            process_hplp(procL, procR);
-            
-            int active = *params[AM::param_ls_active];
-            if (active > 3) diff_ms(procL, procR);
-            if (active == 1 or active == 2 or active == 4)
-                procL = lsL.process(procL);
-            if (active == 1 or active == 3 or active == 5)
-                procR = lsR.process(procR);
-            if (active > 3) undiff_ms(procL, procR);
-            
-            active = *params[AM::param_hs_active];
-            if (active > 3) diff_ms(procL, procR);
-            if (active == 1 or active == 2 or active == 4)
-                procL = hsL.process(procL);
-            if (active == 1 or active == 3 or active == 5)
-                procR = hsR.process(procR);
-            if (active > 3) undiff_ms(procL, procR);
-            
-            for (int i = 0; i < AM::PeakBands; i++)
+        float procL[MAX_SAMPLE_RUN], procR[MAX_SAMPLE_RUN];
+        float level_in = *params[AM::param_level_in];
+        for (uint32_t i = 0; i < orig_numsamples; i++) {
+            procL[i] = ins[0][offset + i] * level_in;
+            procR[i] = ins[1][offset + i] * level_in;
+        }
+        
+        // all filters in chain, a block at a time; stay in M/S between
+        // neighbouring M/S stages instead of converting back every time
+        bool ms = false;
+        for (int s = 0; s < stage_count; s++)
+        {
+            const eq_stage &stage = stages[s];
+            if ((stage.route > 3) != ms) {
+                ms = !ms;
+                for (uint32_t i = 0; i < orig_numsamples; i++) {
+                    if (ms)
+                        diff_ms(procL[i], procR[i]);
+                    else
+                        undiff_ms(procL[i], procR[i]);
+                }
+            }
+            switch(stage.route)
             {
-                int offset = i * params_per_band;
-                int active = *params[AM::param_p1_active + offset];
-                if (active > 3) diff_ms(procL, procR);
-                if (active == 1 or active == 2 or active == 4)
-                    procL = pL[i].process(procL);
-                if (active == 1 or active == 3 or active == 5)
-                    procR = pR[i].process(procR);
-                if (active > 3) undiff_ms(procL, procR);
+                case 1:
+                    process_block_stereo(*stage.left, *stage.right, procL, procR, procL, procR, orig_numsamples);
+                    break;
+                case 2:
+                case 4:
+                    stage.left->process_block(procL, procL, orig_numsamples);
+                    break;
+                case 3:
+                case 5:
+                    stage.right->process_block(procR, procR, orig_numsamples);
+                    break;
             }
-            
-            outL = procL * *params[AM::param_level_out];
-            outR = procR * *params[AM::param_level_out];
+        }
+        if (ms) {
+            for (uint32_t i = 0; i < orig_numsamples; i++)
+                undiff_ms(procL[i], procR[i]);
+        }
+        
+        float level_out = *params[AM::param_level_out];
+        for (uint32_t i = 0; i < orig_numsamples; i++, offset++) {
+            // cycle through samples
+            float inL = ins[0][offset] * level_in;
+            float inR = ins[1][offset] * level_in;
+            float outL = procL[i] * level_out;
+            float outR = procR[i] * level_out;
             
             // analyzer
             _analyzer.process((inL + inR) / 2.f, (outL + outR) / 2.f);
@@ -338,24 +309,8 @@ uint32_t equalizerNband_audio_module<BaseClass, has_lphp>::process(uint32_t offs
             
             float values[] = {inL, inR, outL, outR};
             meters.process(values);
-
-            // next sample
-            ++offset;
         } // cycle trough samples
         bypass.crossfade(ins, outs, 2, orig_offset, orig_numsamples);
-        // clean up
-        for(int i = 0; i < 3; ++i) {
-            hp[i][0].sanitize();
-            hp[i][1].sanitize();
-            lp[i][0].sanitize();
-            lp[i][1].sanitize();
-        }
-        lsL.sanitize();
-        hsR.sanitize();
-        for(int i = 0; i < AM::PeakBands; ++i) {
-            pL[i].sanitize();
-            pR[i].sanitize();
-        }
     }
     meters.fall(numsamples);
     return outputs_mask;
@@ -466,6 +421,7 @@ bool equalizerNband_audio_module<BaseClass, has_lphp>::get_graph(int index, int
 template<class BaseClass, bool has_lphp>
 bool equalizerNband_audio_module<BaseClass, has_lphp>::get_layers(int index, int generation, unsigned int &layers) const
 {
+    _analyzer.release_idle();
     redraw_graph = redraw_graph || !generation;
     layers = *params[AM::param_analyzer_active] ? LG_REALTIME_GRAPH : 0;
     layers |= (generation ? LG_NONE : LG_CACHE_GRID) | (redraw_graph ? LG_CACHE_GRAPH : LG_NONE);
@@ -1005,15 +961,20 @@ uint32_t xover_audio_module<XoverBaseClass>::process(uint32_t offset, uint32_t n
     unsigned int targ = numsamples + offset;
     float xval;
     float values[AM::bands * AM::channels + AM::channels];
+    
+    // split the whole block first, band outputs go straight to the output buffers
+    float *split_ins[AM::channels], *split_outs[AM::bands * AM::channels];
+    for (int c = 0; c < AM::channels; c++) {
+        for (uint32_t i = 0; i < numsamples; i++)
+            split_in[c][i] = ins[c][offset + i] * *params[AM::param_level];
+        split_ins[c] = split_in[c];
+    }
+    for (int i = 0; i < AM::bands * AM::channels; i++)
+        split_outs[i] = outs[i] + offset;
+    crossover.process_block(split_ins, split_outs, numsamples);
+    
     while(offset < targ) {
         // cycle through samples
-        
-        // level
-        for (int c = 0; c < AM::channels; c++) {
-            in[c] = ins[c][offset] * *params[AM::param_level];
-        }
-        crossover.process(in);
-        
         for (int b = 0; b < AM::bands; b++) {
             int nbuf = 0;
             int off = b * params_per_band;
@@ -1027,7 +988,7 @@ uint32_t xover_audio_module<XoverBaseClass>::process(uint32_t offset, uint32_t n
                 int ptr = b * AM::channels + c;
                 
                 // get output from crossover module if active
-                xval = *params[AM::param_active1 + off] > 0.5 ? crossover.get_value(c, b) : 0.f;
+                xval = *params[AM::param_active1 + off] > 0.5 ? outs[ptr][offset] : 0.f;
                 
                 // fill delay buffer
                 buffer[pos + ptr] = xval;
@@ -1145,13 +1106,10 @@ void vocoder_audio_module::params_changed()
             float step = (log10(to) - _freq) / (bands - i) * (1 + tilt);
             float f = pow(10, _freq + (0.5 * step));
             bandfreq[_i] = f;
-            detector[0][0][_i].set_bp_rbj(f, _q, (double)srate);
-            for (int j = 0; j < order; j++) {
-                if (j)
-                    detector[0][j][_i].copy_coeffs(detector[0][0][_i]);
-                detector[1][j][_i].copy_coeffs(detector[0][0][_i]);
-                modulator[0][j][_i].copy_coeffs(detector[0][0][_i]);
-                modulator[1][j][_i].copy_coeffs(detector[0][0][_i]);
+            band_coeffs[_i].set_bp_rbj(f, _q, (double)srate);
+            for (int c = 0; c < 2; c++) {
+                detector[c].set_coeffs(_i, band_coeffs[_i]);
+                modulator[c].set_coeffs(_i, band_coeffs[_i]);
             }
             freq = pow(10, _freq + step);
         }
@@ -1186,6 +1144,30 @@ uint32_t vocoder_audio_module::process(uint32_t offset, uint32_t numsamples, uin
             ++offset;
         }
     } else {
+        // per band gains don't change within a block - fold volume, balance, processed level
+        // and envelope levelling together, with muted (non-solo) bands at 0
+        int nbands = detector[0].padded(bands);
+        bool link = *params[param_link] > 0.5;
+        bool detectors = *params[param_detectors] > 0.5;
+        double levelling = ((float)order / 2 + 4) * 4;
+        double car_gain[2][32], mod_gain[2][32], noise_gain[32];
+        for (int i = 0; i < nbands; i++) {
+            bool active = i < bands && ((solo and *params[param_solo0 + i * band_params]) or !solo);
+            float pan = *params[param_pan0 + i * band_params];
+            double gain = active ? *params[param_proc] : 0;
+            double gainL = gain * (pan > 0 ? -pan + 1 : 1);
+            double gainR = gain * (pan < 0 ? pan + 1 : 1);
+            car_gain[0][i] = gainL * levelling * *params[param_volume0 + i * band_params];
+            car_gain[1][i] = gainR * levelling * *params[param_volume0 + i * band_params];
+            mod_gain[0][i] = gainL * *params[param_mod0 + i * band_params];
+            mod_gain[1][i] = gainR * *params[param_mod0 + i * band_params];
+            noise_gain[i] = *params[param_noise0 + i * band_params];
+        }
+        
+        // noise generator
+        noise.fill(noise_buf[0], orig_numsamples);
+        noise.fill(noise_buf[1], orig_numsamples);
+        
         // process
         while(offset < numsamples) {
             // cycle through samples
@@ -1202,60 +1184,47 @@ uint32_t vocoder_audio_module::process(uint32_t offset, uint32_t numsamples, uin
             double mL = ins[2][offset] * *params[param_mod_in];
             double mR = ins[3][offset] * *params[param_mod_in];
             
-            // noise generator
-            double nL = (float)rand() / (float)RAND_MAX;
-            double nR = (float)rand() / (float)RAND_MAX;
+            double nL = noise_buf[0][offset - orig_offset];
+            double nR = noise_buf[1][offset - orig_offset];
             
-            for (int i = 0; i < bands; i++) {
-                double mL_ = mL;
-                double mR_ = mR;
-                double cL_ = cL + nL * *params[param_noise0 + i * band_params];
-                double cR_ = cR + nR * *params[param_noise0 + i * band_params];
-                
-                if ((solo and *params[param_solo0 + i * band_params]) or !solo) {
-                    for (int j = 0; j < order; j++) {
-                        // filter modulator
-                        if (*params[param_link] > 0.5) {
-                            mL_ = detector[0][j][i].process(std::max(mL_, mR_));
-                            mR_ = mL_;
-                        } else {
-                            mL_ = detector[0][j][i].process(mL_);
-                            mR_ = detector[1][j][i].process(mR_);
-                        }
-                        // filter carrier with noise
-                        cL_ = modulator[0][j][i].process(cL_);
-                        cR_ = modulator[1][j][i].process(cR_);
-                    }
-                    // level by envelope with levelling
-                    cL_ *= env_mods[0][i] * ((float)order / 2 + 4) * 4;
-                    cR_ *= env_mods[1][i] * ((float)order / 2 + 4) * 4;
-                    
-                    // add band volume setting
-                    cL_ *= *params[param_volume0 + i * band_params];
-                    cR_ *= *params[param_volume0 + i * band_params];
-                    
-                    // add filtered modulator
-                    cL_ += mL_ * *params[param_mod0 + i * band_params];
-                    cR_ += mR_ * *params[param_mod0 + i * band_params];
-                    
-                    // Balance
-                    cL_ *= (*params[param_pan0 + i * band_params] > 0
-                         ? -*params[param_pan0 + i * band_params] + 1 : 1);
-                    cR_ *= (*params[param_pan0 + i * band_params] < 0
-                          ? *params[param_pan0 + i * band_params] + 1 : 1);
-                    
-                    // add to outputs with proc level
-                    pL += cL_ * *params[param_proc];
-                    pR += cR_ * *params[param_proc];
+            // all bands side by side, one filter stage at a time
+            double mL_[32], mR_[32], cL_[32], cR_[32];
+            for (int i = 0; i < nbands; i++) {
+                mL_[i] = mL;
+                mR_[i] = mR;
+                cL_[i] = cL + nL * noise_gain[i];
+                cR_[i] = cR + nR * noise_gain[i];
+            }
+            for (int j = 0; j < order; j++) {
+                // filter modulator
+                if (link) {
+                    for (int i = 0; i < nbands; i++)
+                        mL_[i] = std::max(mL_[i], mR_[i]);
+                    detector[0].process_stage(j, mL_, mL_, nbands);
+                    std::copy(mL_, mL_ + nbands, mR_);
+                } else {
+                    detector[0].process_stage(j, mL_, mL_, nbands);
+                    detector[1].process_stage(j, mR_, mR_, nbands);
                 }
+                // filter carrier with noise
+                modulator[0].process_stage(j, cL_, cL_, nbands);
+                modulator[1].process_stage(j, cR_, cR_, nbands);
+            }
+            for (int i = 0; i < nbands; i++) {
+                // level by envelope, add filtered modulator
+                pL += cL_[i] * env_mods[0][i] * car_gain[0][i] + mL_[i] * mod_gain[0][i];
+                pR += cR_[i] * env_mods[1][i] * car_gain[1][i] + mR_[i] * mod_gain[1][i];
+            }
+            for (int i = 0; i < bands; i++) {
                 // LED
-                if (*params[param_detectors] > 0.5)
+                if (detectors)
                     if (env_mods[0][i] + env_mods[1][i] > led[i])
                         led[i] = env_mods[0][i] + env_mods[1][i];
                     
                 // advance envelopes
-                env_mods[0][i] = _sanitize((fabs(mL_) > env_mods[0][i] ? attack : release) * (env_mods[0][i] - fabs(mL_)) + fabs(mL_));
-                env_mods[1][i] = _sanitize((fabs(mR_) > env_mods[1][i] ? attack : release) * (env_mods[1][i] - fabs(mR_)) + fabs(mR_));
+                double aL = fabs(mL_[i]), aR = fabs(mR_[i]);
+                env_mods[0][i] = _sanitize((aL > env_mods[0][i] ? attack : release) * (env_mods[0][i] - aL) + aL);
+                env_mods[1][i] = _sanitize((aR > env_mods[1][i] ? attack : release) * (env_mods[1][i] - aR) + aR);
             }
             
             outL = pL;
@@ -1305,13 +1274,9 @@ uint32_t vocoder_audio_module::process(uint32_t offset, uint32_t numsamples, uin
         } // cycle trough samples
         bypass.crossfade(ins, outs, 2, orig_offset, orig_numsamples);
         // clean up
-        for (int i = 0; i < bands; i++) {
-            for (int j = 0; j < order; j++) {
-                detector[0][j][i].sanitize();
-                detector[1][j][i].sanitize();
-                modulator[0][j][i].sanitize();
-                modulator[1][j][i].sanitize();
-            }
+        for (int c = 0; c < 2; c++) {
+            detector[c].sanitize(bands, order);
+            modulator[c].sanitize(bands, order);
         }
     }
     
@@ -1351,7 +1316,7 @@ bool vocoder_audio_module::get_graph(int index, int subindex, int phase, float *
             double freq = 20.0 * pow (20000.0 / 20.0, i * 1.0 / points);
             float level = 1;
             for (int j = 0; j < order; j++)
-                level *= detector[0][0][subindex].freq_gain(freq, srate);
+                level *= band_coeffs[subindex].freq_gain(freq, srate);
             level *= *params[param_volume0 + subindex * band_params];
             data[i] = dB_grid(level, 256, 0.4);
             if (!drawn and freq > bandfreq[subindex]) {
@@ -1366,6 +1331,7 @@ bool vocoder_audio_module::get_graph(int index, int subindex, int phase, float *
 }
 bool vocoder_audio_module::get_layers(int index, int generation, unsigned int &layers) const
 {
+    _analyzer.release_idle();
     redraw_graph = redraw_graph || !generation;
     layers = *params[param_analyzer] ? LG_REALTIME_GRAPH : 0;
     layers |= (generation ? LG_NONE : LG_CACHE_GRID) | (redraw_graph ? LG_CACHE_GRAPH : LG_NONE);
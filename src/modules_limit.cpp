@@ -59,8 +59,8 @@ void limiter_audio_module::deactivate()
 }
 void limiter_audio_module::set_srates()
 {
-    resampler[0].set_params(srate, *params[param_oversampling], 2);
-    resampler[1].set_params(srate, *params[param_oversampling], 2);
+    resampler[0].set_params(srate, *params[param_oversampling]);
+    resampler[1].set_params(srate, *params[param_oversampling]);
     limiter.set_sample_rate(srate * *params[param_oversampling]);
 }
 void limiter_audio_module::params_changed()
@@ -96,76 +96,66 @@ uint32_t limiter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
     uint32_t orig_numsamples = numsamples;
     uint32_t orig_offset = offset;
     numsamples += offset;
+    float att_buf[MAX_SAMPLE_RUN];
     if(bypassed) {
         // everything bypassed
         while(offset < numsamples) {
             outs[0][offset] = ins[0][offset];
             outs[1][offset] = ins[1][offset];
-            float values[] = {0, 0, 0, 0, 1};
-            meters.process(values);
             ++offset;
         }
+        std::fill(att_buf, att_buf + orig_numsamples, 1.f);
+        const float *values[] = {NULL, NULL, NULL, NULL, att_buf};
+        meters.process(values, orig_numsamples);
         asc_led    = 0.f;
     } else {
         asc_led   -= std::min(asc_led, numsamples);
 
+        // in level, upsample the whole run, limit it and downsample it again
+        int over = resampler[0].get_factor();
+        float level_in = *params[param_level_in];
+        for (uint32_t i = 0; i < orig_numsamples; i++) {
+            run_buf[0][i] = ins[0][offset + i] * level_in;
+            run_buf[1][i] = ins[1][offset + i] * level_in;
+        }
+        resampler[0].upsample(run_buf[0], over_buf[0], orig_numsamples);
+        resampler[1].upsample(run_buf[1], over_buf[1], orig_numsamples);
+        limiter.process_block(over_buf[0], over_buf[1], NULL, orig_numsamples * over);
+        if(limiter.get_asc())
+            asc_led = srate >> 3;
+        resampler[0].downsample(over_buf[0], outs[0] + orig_offset, orig_numsamples);
+        resampler[1].downsample(over_buf[1], outs[1] + orig_offset, orig_numsamples);
+        std::fill(att_buf, att_buf + orig_numsamples, limiter.get_attenuation());
+
+        float limit = *params[param_limit];
+        float level_out = *params[param_level_out];
         while(offset < numsamples) {
             // cycle through samples
-            float inL = ins[0][offset];
-            float inR = ins[1][offset];
-            // in level
-            inR *= *params[param_level_in];
-            inL *= *params[param_level_in];
-            // out vars
-            float outL = inL;
-            float outR = inR;
-            
-            // upsampling
-            double *samplesL = resampler[0].upsample((double)outL);
-            double *samplesR = resampler[1].upsample((double)outR);
-            
-            float tmpL;
-            float tmpR;
-            
-            // process gain reduction
-            float fickdich[0];
-            for (int i = 0; i < *params[param_oversampling]; i ++) {
-                tmpL = samplesL[i];
-                tmpR = samplesR[i];
-                limiter.process(tmpL, tmpR, fickdich);
-                samplesL[i] = tmpL;
-                samplesR[i] = tmpR;
-                if(limiter.get_asc())
-                    asc_led = srate >> 3;
-            }
-            
-            // downsampling
-            outL = resampler[0].downsample(samplesL);
-            outR = resampler[1].downsample(samplesR);
+            float outL = outs[0][offset];
+            float outR = outs[1][offset];
             
             // should never be used. but hackers are paranoid by default.
             // so we make shure NOTHING is above limit
-            outL = std::min(std::max(outL, -*params[param_limit]), *params[param_limit]);
-            outR = std::min(std::max(outR, -*params[param_limit]), *params[param_limit]);
+            outL = std::min(std::max(outL, -limit), limit);
+            outR = std::min(std::max(outR, -limit), limit);
 
             // autolevel
-            outL /= *params[param_limit];
-            outR /= *params[param_limit];
+            outL /= limit;
+            outR /= limit;
 
             // out level
-            outL *= *params[param_level_out];
-            outR *= *params[param_level_out];
+            outL *= level_out;
+            outR *= level_out;
 
             // send to output
             outs[0][offset] = outL;
             outs[1][offset] = outR;
 
-            float values[] = {inL, inR, outL, outR, bypassed ? (float)1.0 : (float)limiter.get_attenuation()};
-            meters.process (values);
-
             // next sample
             ++offset;
         } // cycle trough samples
+        const float *values[] = {run_buf[0], run_buf[1], outs[0] + orig_offset, outs[1] + orig_offset, att_buf};
+        meters.process(values, orig_numsamples);
         bypass.crossfade(ins, outs, 2, orig_offset, orig_numsamples);
     } // process (no bypass)
     meters.fall(numsamples);
@@ -309,8 +299,8 @@ void multibandlimiter_audio_module::set_srates()
     crossover.set_sample_rate(srate);
     for (int j = 0; j < strips; j ++) {
         strip[j].set_sample_rate(srate * over);
-        resampler[j][0].set_params(srate, over, 2);
-        resampler[j][1].set_params(srate, over, 2);
+        resampler[j][0].set_params(srate, over);
+        resampler[j][1].set_params(srate, over);
     }
     // rebuild buffer
     overall_buffer_size = (int)(srate * (100.f / 1000.f) * channels * over) + channels; // buffer size max attack rate
@@ -354,10 +344,10 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             float outR = 0.f;
             float tmpL = 0.f; // used for temporary purposes
             float tmpR = 0.f;
-            double overL[strips * 16];
-            double overR[strips * 16];
-            double resL[16];
-            double resR[16];
+            float overL[strips * 16];
+            float overR[strips * 16];
+            float resL[16];
+            float resR[16];
             
             bool asc_active = false;
             
@@ -379,11 +369,11 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             // cycle over strips
             for (int i = 0; i < strips; i++) {
                 // upsample
-                double *samplesL = resampler[i][0].upsample((double)crossover.get_value(0, i));
-                double *samplesR = resampler[i][1].upsample((double)crossover.get_value(1, i));
+                float *samplesL = resampler[i][0].upsample(crossover.get_value(0, i));
+                float *samplesR = resampler[i][1].upsample(crossover.get_value(1, i));
                 // copy to cache
-                memcpy(&overL[i * 16], samplesL, sizeof(double) * over);
-                memcpy(&overR[i * 16], samplesR, sizeof(double) * over);
+                memcpy(&overL[i * 16], samplesL, sizeof(float) * over);
+                memcpy(&overR[i * 16], samplesR, sizeof(float) * over);
                 //if(!(cnt%200)) printf("u0: %.5f\n", overL[i*16]);
             }
             
@@ -441,15 +431,15 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
                     int p = i * 16 + o;
                     //if(!(cnt%200) and !o) printf("u1: %.5f\n", overL[p]);
                     // limit
-                    tmpL = (float)overL[p];
-                    tmpR = (float)overR[p];
+                    tmpL = overL[p];
+                    tmpR = overR[p];
                     //if(!(cnt%200)) printf("1: %.5f\n", tmpL);
                     strip[i].process(tmpL, tmpR, buffer);
                     //if(!(cnt%200)) printf("2: %.5f\n\n", tmpL);
                     if (solo[i] || no_solo) {
                         // add
-                        resL[o] += (double)tmpL;
-                        resR[o] += (double)tmpR;
+                        resL[o] += tmpL;
+                        resR[o] += tmpR;
                         // flash the asc led?
                         asc_active = asc_active || strip[i].get_asc();
                     }
@@ -460,14 +450,14 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
                 tmpL = resL[o];
                 tmpR = resR[o];
                 broadband.process(tmpL, tmpR, fickdich);
-                resL[o] = (double)tmpL;
-                resR[o] = (double)tmpR;
+                resL[o] = tmpL;
+                resR[o] = tmpR;
                 asc_active = asc_active || broadband.get_asc();
             }
             
             // downsampling
-            outL = (float)resampler[0][0].downsample(resL);
-            outR = (float)resampler[0][1].downsample(resR);
+            outL = resampler[0][0].downsample(resL);
+            outR = resampler[0][1].downsample(resR);
             
             //if(!(cnt%50)) printf("o: %.5f %.5f\n\n", outL, resL[0]);
             
@@ -705,8 +695,8 @@ void sidechainlimiter_audio_module::set_srates()
     crossover.set_sample_rate(srate);
     for (int j = 0; j < strips; j ++) {
         strip[j].set_sample_rate(srate * over);
-        resampler[j][0].set_params(srate, over, 2);
-        resampler[j][1].set_params(srate, over, 2);
+        resampler[j][0].set_params(srate, over);
+        resampler[j][1].set_params(srate, over);
     }
     // rebuild buffer
     overall_buffer_size = (int)(srate * (100.f / 1000.f) * channels * over) + channels; // buffer size max attack rate
@@ -752,10 +742,10 @@ uint32_t sidechainlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             float outR = 0.f;
             float tmpL = 0.f; // used for temporary purposes
             float tmpR = 0.f;
-            double overL[strips * 16];
-            double overR[strips * 16];
-            double resL[16];
-            double resR[16];
+            float overL[strips * 16];
+            float overR[strips * 16];
+            float resL[16];
+            float resR[16];
             
             bool asc_active = false;
             
@@ -782,18 +772,18 @@ uint32_t sidechainlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             
             // cycle over strips
             for (int i = 0; i < strips; i++) {
-                double *samplesR, *samplesL;
+                float *samplesR, *samplesL;
                 // upsample
                 if (i < strips - 1) {
-                    samplesL = resampler[i][0].upsample((double)crossover.get_value(0, i));
-                    samplesR = resampler[i][1].upsample((double)crossover.get_value(1, i));
+                    samplesL = resampler[i][0].upsample(crossover.get_value(0, i));
+                    samplesR = resampler[i][1].upsample(crossover.get_value(1, i));
                 } else {
-                    samplesL = resampler[i][0].upsample((double)scL);
-                    samplesR = resampler[i][1].upsample((double)scR);
+                    samplesL = resampler[i][0].upsample(scL);
+                    samplesR = resampler[i][1].upsample(scR);
                 }
                 // copy to cache
-                memcpy(&overL[i * 16], samplesL, sizeof(double) * over);
-                memcpy(&overR[i * 16], samplesR, sizeof(double) * over);
+                memcpy(&overL[i * 16], samplesL, sizeof(float) * over);
+                memcpy(&overR[i * 16], samplesR, sizeof(float) * over);
                 //if(!(cnt%200)) printf("u0: %.5f\n", overL[i*16]);
             }
             
@@ -824,15 +814,15 @@ uint32_t sidechainlimiter_audio_module::process(uint32_t offset, uint32_t numsam
                     int p = i * 16 + o;
                     //if(!(cnt%200) and !o) printf("u1: %.5f\n", overL[p]);
                     // limit
-                    tmpL = (float)overL[p];
-                    tmpR = (float)overR[p];
+                    tmpL = overL[p];
+                    tmpR = overR[p];
                     //if(!(cnt%200)) printf("1: %.5f\n", tmpL);
                     strip[i].process(tmpL, tmpR, buffer);
                     //if(!(cnt%200)) printf("2: %.5f\n\n", tmpL);
                     if (solo[i] || no_solo) {
                         // add
-                        resL[o] += (double)tmpL;
-                        resR[o] += (double)tmpR;
+                        resL[o] += tmpL;
+                        resR[o] += tmpR;
                         // flash the asc led?
                         asc_active = asc_active || strip[i].get_asc();
                     }
@@ -843,14 +833,14 @@ uint32_t sidechainlimiter_audio_module::process(uint32_t offset, uint32_t numsam
                 tmpL = resL[o];
                 tmpR = resR[o];
                 broadband.process(tmpL, tmpR, fickdich);
-                resL[o] = (double)tmpL;
-                resR[o] = (double)tmpR;
+                resL[o] = tmpL;
+                resR[o] = tmpR;
                 asc_active = asc_active || broadband.get_asc();
             }
             
             // downsampling
-            outL = (float)resampler[0][0].downsample(resL);
-            outR = (float)resampler[0][1].downsample(resR);
+            outL = resampler[0][0].downsample(resL);
+            outR = resampler[0][1].downsample(resR);
             
             //if(!(cnt%50)) printf("o: %.5f %.5f\n\n", outL, resL[0]);
             
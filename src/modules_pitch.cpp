@@ -34,6 +34,9 @@ using namespace calf_plugins;
 
 pitch_audio_module::pitch_audio_module()
 {
+    for (int i = 0; i < BufferSize; ++i)
+        window[i] = 0.54 - 0.46 * cos(i * M_PI / BufferSize);
+    stage = STAGE_IDLE;
 }
 
 pitch_audio_module::~pitch_audio_module()
@@ -52,47 +55,75 @@ void pitch_audio_module::params_changed()
 void pitch_audio_module::activate()
 {
     write_ptr = 0;
-    for (size_t i = 0; i < 2 * BufferSize; ++i)
-        waveform[i] = spectrum[i] = autocorr[i] = 0;
+    stage = STAGE_IDLE;
+    nyquist = 0;
+    sumsquares_last = 0;
     for (size_t i = 0; i < BufferSize; ++i)
-        inputbuf[i] = 0;
+        inputbuf[i] = waveform[i] = spectrum[i] = power[i] = autocorr[i] = 0;
 }
 
 void pitch_audio_module::deactivate()
 {
 }
 
-void pitch_audio_module::recompute()
+void pitch_audio_module::start_recompute()
 {
-    // second half of the waveform always zero
+    // take a windowed snapshot of the input; the transforms happen in
+    // recompute_step, in the following process() calls
     double sumsquares_acc = 0.;
+    float nyq = 0.f;
     for (int i = 0; i < BufferSize; ++i)
     {
-        float val = inputbuf[(i + write_ptr) & (BufferSize - 1)];
-        float win = 0.54 - 0.46 * cos(i * M_PI / BufferSize);
-        val *= win;
+        float val = inputbuf[(i + write_ptr) & (BufferSize - 1)] * window[i];
         waveform[i] = val;
         sumsquares[i] = sumsquares_acc;
         sumsquares_acc += val * val;
+        nyq += (i & 1) ? -val : val;
     }
     sumsquares[BufferSize] = sumsquares_acc;
-        //waveform[i] = inputbuf[(i + write_ptr) & (BufferSize - 1)];
-    transform.calculate(waveform, spectrum, false);
-    pfft::complex temp[2 * BufferSize];
-    for (int i = 0; i < 2 * BufferSize; ++i)
+    nyquist = nyq;
+    stage = STAGE_SPECTRUM;
+}
+
+void pitch_audio_module::recompute_step()
+{
+    switch(stage)
     {
-        float val = std::abs(spectrum[i]);
-        temp[i] = val * val;
+        case STAGE_IDLE:
+            break;
+        case STAGE_SPECTRUM:
+            transform.execute_r2r(BufferOrder, waveform, spectrum, fft_temp, false);
+            stage = STAGE_AUTOCORR;
+            break;
+        case STAGE_AUTOCORR:
+            // power spectrum is real and even, so the autocorrelation is the
+            // real part of its (real input) inverse transform
+            power[0] = spectrum[0] * spectrum[0];
+            power[BufferSize / 2] = nyquist * nyquist;
+            for (int i = 1; i < BufferSize / 2; ++i)
+            {
+                float re = spectrum[i], im = spectrum[BufferSize - 1 - i];
+                power[i] = power[BufferSize - i] = re * re + im * im;
+            }
+            transform.execute_r2r(BufferOrder, power, autocorr, fft_temp, true);
+            stage = STAGE_PEAK;
+            break;
+        case STAGE_PEAK:
+            find_pitch();
+            stage = STAGE_IDLE;
+            break;
     }
-        //temp[i] = spectrum[i] * std::conj(spectrum[i]);
-    transform.calculate(temp, autocorr, true);
-    sumsquares_last = sumsquares_acc;
+}
+
+void pitch_audio_module::find_pitch()
+{
+    sumsquares_last = sumsquares[BufferSize];
     float maxpt = 0;
     int maxpos = -1;
     int i;
     for (i = 2; i < BufferSize / 2; ++i)
     {
-        float mag = 2.0 * autocorr[i].real() / (sumsquares[BufferSize] + sumsquares[BufferSize - i] - sumsquares[i]);
+        float mag = 2.0 * autocorr[i] / (sumsquares[BufferSize] + sumsquares[BufferSize - i] - sumsquares[i]);
         magarr[i] = mag;
         if (mag > maxpt)
         {
@@ -136,7 +167,7 @@ bool pitch_audio_module::get_graph(int index, int subindex, int phase, float *da
         context->set_source_rgba(1, 0, 0);
         for (int i = 0; i < points; i++)
         {
-            float ac = autocorr[i * (BufferSize / 2 - 1) / (points - 1)].real();
+            float ac = autocorr[i * (BufferSize / 2 - 1) / (points - 1)];
             if (ac >= 0)
                 data[i] = sqrt(ac / sumsquares_last);
             else
@@ -149,7 +180,9 @@ bool pitch_audio_module::get_graph(int index, int subindex, int phase, float *da
         context->set_source_rgba(0, 0, 1);
         for (int i = 0; i < points; i++)
         {
-            data[i] = 0.0625 * log(std::abs(spectrum[i * (BufferSize / 4 - 1) / (points - 1)]));
+            int j = i * (BufferSize / 4 - 1) / (points - 1);
+            float im = j ? spectrum[BufferSize - 1 - j] : 0.f;
+            data[i] = 0.0625 * log(sqrt(spectrum[j] * spectrum[j] + im * im));
         }
         return true;
     }
@@ -194,12 +227,13 @@ uint32_t pitch_audio_module::process(uint32_t offset, uint32_t numsamples, uint3
         float val = ins[0][i];
         inputbuf[write_ptr] = val;
         write_ptr = (write_ptr + 1) & (BufferSize - 1);
-        if (!(write_ptr % bperiod))
-            recompute();
+        if (!(write_ptr % bperiod) && stage == STAGE_IDLE)
+            start_recompute();
         outs[0][i] = ins[0][i];
         if (has2nd)
             outs[1][i] = ins[1][i];
     }
+    recompute_step();
     return outputs_mask;
 }
 
@@ -69,20 +69,12 @@ void stereo_audio_module::params_changed() {
 uint32_t stereo_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask) {
     bool bypassed = bypass.update(*params[param_bypass] > 0.5f, numsamples);
     uint32_t orig_offset = offset;
+    float meter_inL[MAX_SAMPLE_RUN], meter_inR[MAX_SAMPLE_RUN];
     for(uint32_t i = offset; i < offset + numsamples; i++) {
         if(bypassed) {
             outs[0][i] = ins[0][i];
             outs[1][i] = ins[1][i];
-            meter_inL  = 0.f;
-            meter_inR  = 0.f;
-            meter_outL = 0.f;
-            meter_outR = 0.f;
         } else {
-            meter_inL = 0.f;
-            meter_inR = 0.f;
-            meter_outL = 0.f;
-            meter_outR = 0.f;
-            
             float L = ins[0][i];
             float R = ins[1][i];
             
@@ -101,8 +93,8 @@ uint32_t stereo_audio_module::process(uint32_t offset, uint32_t numsamples, uint
             }
             
             // GUI stuff
-            meter_inL = L;
-            meter_inR = R;
+            meter_inL[i - orig_offset] = L;
+            meter_inR[i - orig_offset] = R;
             
             // modes
             float slev = *params[param_slev];       // slev - stereo level ( -2 -> 2 )
@@ -215,9 +207,6 @@ uint32_t stereo_audio_module::process(uint32_t offset, uint32_t numsamples, uint
             outs[0][i] = L;
             outs[1][i] = R;
             
-            meter_outL = L;
-            meter_outR = R;
-            
             // phase meter
             if(fabs(L) > 0.001 and fabs(R) > 0.001) {
                 meter_phase = fabs(fabs(L+R) > 0.000000001 ? sin(fabs((L-R)/(L+R))) : 0.f);
@@ -225,11 +214,15 @@ uint32_t stereo_audio_module::process(uint32_t offset, uint32_t numsamples, uint
                 meter_phase = 0.f;
             }
         }
-        float values[] = {meter_inL, meter_inR, meter_outL, meter_outR};
-        meters.process(values);
     }
-    if (!bypassed)
+    if (bypassed) {
+        const float *values[] = {NULL, NULL, NULL, NULL};
+        meters.process(values, numsamples);
+    } else {
+        const float *values[] = {meter_inL, meter_inR, outs[0] + orig_offset, outs[1] + orig_offset};
+        meters.process(values, numsamples);
         bypass.crossfade(ins, outs, 2, orig_offset, numsamples);
+    }
     meters.fall(numsamples);
     return outputs_mask;
 }
@@ -252,9 +245,6 @@ void stereo_audio_module::set_sample_rate(uint32_t sr)
 
 mono_audio_module::mono_audio_module() {
     active      = false;
-    meter_in    = 0.f;
-    meter_outL  = 0.f;
-    meter_outR  = 0.f;
     _phase      = -1.f;
     _sc_level   = 0.f;
     buffer = NULL;
@@ -285,18 +275,12 @@ void mono_audio_module::params_changed() {
 uint32_t mono_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask) {
     bool bypassed = bypass.update(*params[param_bypass] > 0.5f, numsamples);
     uint32_t orig_offset = offset;
+    float meter_in[MAX_SAMPLE_RUN];
     for(uint32_t i = offset; i < offset + numsamples; i++) {
         if(bypassed) {
             outs[0][i] = ins[0][i];
             outs[1][i] = ins[0][i];
-            meter_in    = 0.f;
-            meter_outL  = 0.f;
-            meter_outR  = 0.f;
         } else {
-            meter_in     = 0.f;
-            meter_outL   = 0.f;
-            meter_outR   = 0.f;
-            
             float L = ins[0][i];
             
             // levels in
@@ -310,7 +294,7 @@ uint32_t mono_audio_module::process(uint32_t offset, uint32_t numsamples, uint32
             }
             
             // GUI stuff
-            meter_in = L;
+            meter_in[i - orig_offset] = L;
             
             float R = L;
             
@@ -364,15 +348,16 @@ uint32_t mono_audio_module::process(uint32_t offset, uint32_t numsamples, uint32
             //output
             outs[0][i] = L;
             outs[1][i] = R;
-            
-            meter_outL = L;
-            meter_outR = R;
         }
-        float values[] = {meter_in, meter_outL, meter_outR};
-        meters.process(values);
     }
-    if (!bypassed)
+    if (bypassed) {
+        const float *values[] = {NULL, NULL, NULL};
+        meters.process(values, numsamples);
+    } else {
+        const float *values[] = {meter_in, outs[0] + orig_offset, outs[1] + orig_offset};
+        meters.process(values, numsamples);
         bypass.crossfade(ins, outs, 2, orig_offset, numsamples);
+    }
     meters.fall(numsamples);
     return outputs_mask;
 }
@@ -813,15 +813,21 @@ uint32_t monosynth_audio_module::process(uint32_t offset, uint32_t nsamples, uin
             if (running)
             {
                 had_data = 3;
-                if (is_stereo_filter())
+                float *bufR = is_stereo_filter() ? buffer2 : buffer;
+                float vol[step_size];
+                if (master.get_block(vol, len))
                     for(uint32_t i = 0 ; i < len; i++) {
-                        float vol = master.get();
-                        outs[0][op + i] = buffer[ip + i] * vol;
-                        outs[1][op + i] = buffer2[ip + i] * vol;
+                        outs[0][op + i] = buffer[ip + i] * vol[i];
+                        outs[1][op + i] = bufR[ip + i] * vol[i];
                     }
                 else
-                    for(uint32_t i = 0 ; i < len; i++)
-                        outs[0][op + i] = outs[1][op + i] = buffer[ip + i] * master.get();
+                {
+                    float v = master.get_last();
+                    for(uint32_t i = 0 ; i < len; i++) {
+                        outs[0][op + i] = buffer[ip + i] * v;
+                        outs[1][op + i] = bufR[ip + i] * v;
+                    }
+                }
             }
             else 
             {
@@ -23,6 +23,17 @@
 #include <calf/giface.h>
 #include <calf/organ.h>
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 using namespace std;
 using namespace dsp;
@@ -228,7 +239,7 @@ static void padsynth(bandlimiter<ORGAN_WAVE_BITS> blSrc, bandlimiter<ORGAN_BIG_W
     
     // limit is 1/2 of the number of harmonics of the original wave
     result.make_from_spectrum(blDest, foldover, ORGAN_WAVE_SIZE >> (1 + ORGAN_BIG_WAVE_SHIFT));
-    memcpy(result.original, result.begin()->second, sizeof(result.original));
+    result.set_original(result.get_table(0));
     #if 0
     blDest.compute_waveform(result);
     normalize_waveform(result, ORGAN_BIG_WAVE_SIZE);
@@ -238,6 +249,225 @@ static void padsynth(bandlimiter<ORGAN_WAVE_BITS> blSrc, bandlimiter<ORGAN_BIG_W
     #endif
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// On-disk cache of the precalculated organ waveforms. The tables take seconds to compute and
+/// several MB per process, so they are written once to $XDG_CACHE_HOME/calf (~/.cache/calf) and
+/// mapped read-only by every later instance, which also lets processes share them via page cache.
+namespace organ_wave_cache {
+
+/// Bump whenever the waveform generation code changes, so that stale cache files get rebuilt
+enum { FORMAT_VERSION = 1 };
+
+struct header
+{
+    char magic[8];
+    uint32_t version;
+    /// 0x01020304 as written by the creating machine - catches byte order mismatches
+    uint32_t byte_order;
+    uint32_t small_bits, big_bits;
+    uint32_t small_count, big_count;
+    /// total number of bandlimited tables in the file
+    uint32_t table_count;
+    /// checksum of everything following the header
+    uint32_t checksum;
+    uint64_t file_size;
+    char package_string[32];
+};
+
+static const char magic[8] = { 'C', 'A', 'L', 'F', 'O', 'W', 'C', 0 };
+
+/// FNV-1a over 32-bit words (all sections of the file are a multiple of 4 bytes long)
+static uint32_t checksum(uint32_t hash, const void *data, size_t bytes)
+{
+    const uint32_t *words = (const uint32_t *)data;
+    for (size_t i = 0; i < bytes / 4; i++)
+        hash = (hash ^ words[i]) * 16777619U;
+    return hash;
+}
+
+static string get_path()
+{
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache)
+        return string(cache) + "/calf/organ-waves.bin";
+    const char *home = getenv("HOME");
+    if (!home || !*home)
+        return string();
+    return string(home) + "/.cache/calf/organ-waves.bin";
+}
+
+/// Size of directory (per-family table counts followed by the level keys), padded to 16 bytes
+static size_t directory_size(uint32_t families, uint32_t tables)
+{
+    return ((families + tables) * sizeof(uint32_t) + 15) & ~15;
+}
+
+template<class Family>
+static size_t family_size(uint32_t tables)
+{
+    return (Family::SIZE + tables * Family::TABLE_STRIDE) * sizeof(float);
+}
+
+template<class Family>
+static float *attach(Family &family, float *data, const uint32_t *keys, uint32_t count)
+{
+    family.attach(data, keys, data + Family::SIZE, count);
+    return data + Family::SIZE + count * Family::TABLE_STRIDE;
+}
+
+/// Map the cache file and point the families at it. Returns false (and leaves the families
+/// alone) if there is no usable cache file.
+static bool load(organ_voice_base::small_wave_family *waves, organ_voice_base::big_wave_family *big_waves)
+{
+    typedef organ_voice_base::small_wave_family small_family;
+    typedef organ_voice_base::big_wave_family big_family;
+    const uint32_t small_count = organ_voice_base::wave_count_small, big_count = organ_voice_base::wave_count_big;
+    string path = get_path();
+    if (path.empty())
+        return false;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(header))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void *mem = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return false;
+    
+    const header &hdr = *(const header *)mem;
+    const uint32_t *counts = (const uint32_t *)(&hdr + 1);
+    bool ok = !memcmp(hdr.magic, magic, sizeof(magic)) && hdr.version == FORMAT_VERSION && hdr.byte_order == 0x01020304
+        && hdr.small_bits == ORGAN_WAVE_BITS && hdr.big_bits == ORGAN_BIG_WAVE_BITS
+        && hdr.small_count == small_count && hdr.big_count == big_count
+        && hdr.file_size == size && !strncmp(hdr.package_string, PACKAGE_STRING, sizeof(hdr.package_string))
+        && size >= sizeof(header) + directory_size(small_count + big_count, 0);
+    if (ok)
+    {
+        // check that the directory is consistent with the file size before trusting any of it
+        size_t expected = sizeof(header), total = 0;
+        for (uint32_t i = 0; i < small_count + big_count && total <= hdr.table_count; i++)
+        {
+            if (counts[i] > (i < small_count ? (uint32_t)small_family::MAX_LEVELS : (uint32_t)big_family::MAX_LEVELS))
+                total = hdr.table_count + 1;
+            total += counts[i];
+            expected += i < small_count ? family_size<small_family>(counts[i]) : family_size<big_family>(counts[i]);
+        }
+        expected += directory_size(small_count + big_count, hdr.table_count);
+        ok = total == hdr.table_count && expected == size
+            && hdr.checksum == checksum(2166136261U, &hdr + 1, size - sizeof(header));
+    }
+    if (!ok)
+    {
+        munmap(mem, size);
+        return false;
+    }
+    
+    // the mapping stays for the lifetime of the process, the families point into it
+    const uint32_t *keys = counts + small_count + big_count;
+    float *data = (float *)((char *)mem + sizeof(header) + directory_size(small_count + big_count, hdr.table_count));
+    for (uint32_t i = 0; i < small_count; keys += counts[i], i++)
+        data = attach(waves[i], data, keys, counts[i]);
+    for (uint32_t i = 0; i < big_count; keys += counts[small_count + i], i++)
+        data = attach(big_waves[i], data, keys, counts[small_count + i]);
+    return true;
+}
+
+template<class Family>
+static void describe(Family &family, vector<uint32_t> &counts, vector<uint32_t> &keys)
+{
+    counts.push_back(family.size());
+    for (unsigned int i = 0; i < family.size(); i++)
+        keys.push_back(family.get_key(i));
+}
+
+/// Write the original and the tables, including the (zeroed) padding after each table
+template<class Family>
+static bool write_family(FILE *f, Family &family, uint32_t &hash)
+{
+    hash = checksum(hash, family.original, Family::SIZE * sizeof(float));
+    if (fwrite(family.original, sizeof(float), Family::SIZE, f) != Family::SIZE)
+        return false;
+    for (unsigned int i = 0; i < family.size(); i++)
+    {
+        hash = checksum(hash, family.get_table(i), Family::TABLE_STRIDE * sizeof(float));
+        if (fwrite(family.get_table(i), sizeof(float), Family::TABLE_STRIDE, f) != Family::TABLE_STRIDE)
+            return false;
+    }
+    return true;
+}
+
+/// Create the directories leading to path (errors are left for the following open to report)
+static void make_dirs(const string &path)
+{
+    for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1))
+        mkdir(path.substr(0, pos).c_str(), 0755);
+}
+
+/// Write freshly calculated families to the cache. The file is written under a temporary
+/// name and renamed into place, so that concurrent readers never see a partial file.
+static void save(organ_voice_base::small_wave_family *waves, organ_voice_base::big_wave_family *big_waves)
+{
+    const uint32_t small_count = organ_voice_base::wave_count_small, big_count = organ_voice_base::wave_count_big;
+    string path = get_path();
+    if (path.empty())
+        return;
+    make_dirs(path);
+    char suffix[32];
+    sprintf(suffix, ".%d.tmp", (int)getpid());
+    string tmp_path = path + suffix;
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f)
+        return;
+    
+    vector<uint32_t> directory, keys;
+    for (uint32_t i = 0; i < small_count; i++)
+        describe(waves[i], directory, keys);
+    for (uint32_t i = 0; i < big_count; i++)
+        describe(big_waves[i], directory, keys);
+    uint32_t table_count = keys.size();
+    directory.insert(directory.end(), keys.begin(), keys.end());
+    directory.resize(directory_size(small_count + big_count, table_count) / sizeof(uint32_t), 0);
+    
+    header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, magic, sizeof(magic));
+    hdr.version = FORMAT_VERSION;
+    hdr.byte_order = 0x01020304;
+    hdr.small_bits = ORGAN_WAVE_BITS;
+    hdr.big_bits = ORGAN_BIG_WAVE_BITS;
+    hdr.small_count = small_count;
+    hdr.big_count = big_count;
+    hdr.table_count = table_count;
+    strncpy(hdr.package_string, PACKAGE_STRING, sizeof(hdr.package_string) - 1);
+    
+    // the header is written twice - the second time with the checksum and size filled in
+    uint32_t hash = checksum(2166136261U, &directory.front(), directory.size() * sizeof(uint32_t));
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+        && fwrite(&directory.front(), sizeof(uint32_t), directory.size(), f) == directory.size();
+    for (uint32_t i = 0; ok && i < small_count; i++)
+        ok = write_family(f, waves[i], hash);
+    for (uint32_t i = 0; ok && i < big_count; i++)
+        ok = write_family(f, big_waves[i], hash);
+    if (ok)
+    {
+        hdr.checksum = hash;
+        hdr.file_size = ftell(f);
+        ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) == -1)
+        unlink(tmp_path.c_str());
+}
+
+}
+
 #define LARGE_WAVEFORM_PROGRESS() do { if (reporter) { progress += 100; reporter->report_progress(floor(progress / totalwaves), "Precalculating large waveforms"); } } while(0)
 
 void organ_voice_base::update_pitch()
@@ -256,6 +486,11 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
         static organ_voice_base::big_wave_family big_waves[organ_voice_base::wave_count_big];
         organ_voice_base::waves = &waves;
         organ_voice_base::big_waves = &big_waves;
+        if (organ_wave_cache::load(waves, big_waves))
+        {
+            inited = true;
+            return;
+        }
         
         float progress = 0.0;
         int totalwaves = 1 + wave_count_big;
@@ -498,6 +733,7 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
         padsynth(bl, blBig, big_waves[wave_choir3 - wave_count_small], 50, 10);
         LARGE_WAVEFORM_PROGRESS();
         
+        organ_wave_cache::save(waves, big_waves);
         inited = true;
     }
 }
@@ -614,14 +850,131 @@ void organ_vibrato::process(organ_parameters *parameters, float (*data)[2], unsi
     }
 }
 
+scanner_line_box::scanner_line_box()
+{
+    srate = 0;
+    reset();
+}
+
+void scanner_line_box::reset()
+{
+    for (int i = 0; i < Lanes; i++)
+        w1[i] = w2[i] = 0.f;
+}
+
+void scanner_line_box::set_sample_rate(float sample_rate)
+{
+    if (sample_rate == srate)
+        return;
+    srate = sample_rate;
+    // I bet the original components of the line box had some tolerance,
+    // hence two different values of cutoff frequency; the gain makes up
+    // for the losses of each stage
+    dsp::biquad_d2 lp[2];
+    lp[0].set_lp_rbj(4000, 0.707, sample_rate, 1.03);
+    lp[1].set_lp_rbj(4200, 0.707, sample_rate, 1.03);
+    for (int i = 0; i < 2; i++)
+    {
+        coeffs[i][0] = lp[i].a0;
+        coeffs[i][1] = lp[i].a1;
+        coeffs[i][2] = lp[i].a2;
+        coeffs[i][3] = lp[i].b1;
+        coeffs[i][4] = lp[i].b2;
+    }
+}
+
+void scanner_line_box::process(const float *input, float (*out)[Lanes], unsigned int len)
+{
+#if defined(__SSE__)
+    enum { Vectors = Lanes / 4 };
+    const unsigned int steps = len + Stages - 1;
+    // stage k uses the coefficients of k & 1, and 4 is even, so all registers look the same
+    const __m128 a0 = _mm_setr_ps(coeffs[0][0], coeffs[1][0], coeffs[0][0], coeffs[1][0]);
+    const __m128 a1 = _mm_setr_ps(coeffs[0][1], coeffs[1][1], coeffs[0][1], coeffs[1][1]);
+    const __m128 a2 = _mm_setr_ps(coeffs[0][2], coeffs[1][2], coeffs[0][2], coeffs[1][2]);
+    const __m128 b1 = _mm_setr_ps(coeffs[0][3], coeffs[1][3], coeffs[0][3], coeffs[1][3]);
+    const __m128 b2 = _mm_setr_ps(coeffs[0][4], coeffs[1][4], coeffs[0][4], coeffs[1][4]);
+    __m128 s1[Vectors], s2[Vectors], prev[Vectors], stage[Vectors];
+    for (int v = 0; v < Vectors; v++)
+    {
+        s1[v] = _mm_loadu_ps(w1 + 4 * v);
+        s2[v] = _mm_loadu_ps(w2 + 4 * v);
+        prev[v] = _mm_setzero_ps();
+        stage[v] = _mm_setr_ps(4 * v, 4 * v + 1, 4 * v + 2, 4 * v + 3);
+    }
+    for (unsigned int s = 0; s < steps; s++)
+    {
+        // each stage takes what the stage before it produced in the previous step,
+        // the first one takes the next input sample
+        __m128 carry = _mm_set_ss(s < len ? input[s] : 0.f);
+        // while the wavefront enters or leaves the block, only stages with 0 <= s - k < len
+        // have a sample to work on - the others must keep their state
+        bool partial = s < Stages - 1 || s >= len;
+        __m128 first = _mm_set1_ps((float)s - (float)len), last = _mm_set1_ps((float)s);
+        for (int v = 0; v < Vectors; v++)
+        {
+            __m128 rot = _mm_shuffle_ps(prev[v], prev[v], _MM_SHUFFLE(2, 1, 0, 3));
+            __m128 x = _mm_move_ss(rot, carry);
+            carry = rot;
+            __m128 tmp = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(s1[v], b1)), _mm_mul_ps(s2[v], b2));
+            __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tmp, a0), _mm_mul_ps(s1[v], a1)), _mm_mul_ps(s2[v], a2));
+            if (partial)
+            {
+                __m128 active = _mm_and_ps(_mm_cmple_ps(stage[v], last), _mm_cmpgt_ps(stage[v], first));
+                s2[v] = _mm_or_ps(_mm_and_ps(active, s1[v]), _mm_andnot_ps(active, s2[v]));
+                s1[v] = _mm_or_ps(_mm_and_ps(active, tmp), _mm_andnot_ps(active, s1[v]));
+            }
+            else
+            {
+                s2[v] = s1[v];
+                s1[v] = tmp;
+            }
+            prev[v] = y;
+            _mm_storeu_ps(out[s] + 4 * v, y);
+        }
+    }
+    for (int v = 0; v < Vectors; v++)
+    {
+        _mm_storeu_ps(w1 + 4 * v, s1[v]);
+        _mm_storeu_ps(w2 + 4 * v, s2[v]);
+    }
+#else
+    for (int k = 0; k < Stages; k++)
+    {
+        const float *c = coeffs[k & 1];
+        float l1 = w1[k], l2 = w2[k];
+        for (unsigned int i = 0; i < len; i++)
+        {
+            float x = k ? out[i + k - 1][k - 1] : input[i];
+            float tmp = x - l1 * c[3] - l2 * c[4];
+            out[i + k][k] = tmp * c[0] + l1 * c[1] + l2 * c[2];
+            l2 = l1;
+            l1 = tmp;
+        }
+        w1[k] = l1;
+        w2[k] = l2;
+    }
+#endif
+    for (int i = 0; i < Lanes; i++)
+    {
+        dsp::sanitize(w1[i]);
+        dsp::sanitize(w2[i]);
+    }
+}
+
 void scanner_vibrato::reset()
 {
     legacy.reset();
-    for (int i = 0; i < ScannerSize; i++)
-        scanner[i].reset();
+    line_box.reset();
     lfo_phase = 0.f;
 }
 
+/// Output of the line box tap (0 = the input) for sample i of a block
+static inline float line_tap(const float *input, float (*line)[scanner_line_box::Lanes], int tap, unsigned int i)
+{
+    return tap ? line[i + tap - 1][tap - 1] : input[i];
+}
+
 void scanner_vibrato::process(organ_parameters *parameters, float (*data)[2], unsigned int len, float sample_rate)
 {
     if (!len)
@@ -634,14 +987,7 @@ void scanner_vibrato::process(organ_parameters *parameters, float (*data)[2], un
         return;
     }
     
-    // I bet the original components of the line box had some tolerance,
-    // hence two different values of cutoff frequency
-    scanner[0].set_lp_rbj(4000, 0.707, sample_rate);
-    scanner[1].set_lp_rbj(4200, 0.707, sample_rate);
-    for (int t = 2; t < ScannerSize; t ++)
-    {
-        scanner[t].copy_coeffs(scanner[t & 1]);
-    }
+    line_box.set_sample_rate(sample_rate);
     
     float lfo_phase2 = lfo_phase + parameters->lfo_phase * (1.0 / 360.0);
     if (lfo_phase2 >= 1.0)
@@ -658,39 +1004,40 @@ void scanner_vibrato::process(organ_parameters *parameters, float (*data)[2], un
     float vibamt = 8 * parameters->lfo_amt;
     if (vtype == organ_enums::lfotype_cvfull)
         vibamt = 17 * parameters->lfo_amt;
-    for (unsigned int i = 0; i < len; i++)
+    for (unsigned int start = 0; start < len; start += scanner_line_box::MaxBlock)
     {
-        float line[ScannerSize + 1];
-        float v0 = (data[i][0] + data[i][1]) * 0.5;
-        
-        line[0] = v0;
-        for (int t = 0; t < ScannerSize; t++)
-            line[t + 1] = scanner[t].process(line[t]) * 1.03;
-        
-        float lfo1 = lfo_phase < 0.5 ? 2 * lfo_phase : 2 - 2 * lfo_phase;
-        float lfo2 = lfo_phase2 < 0.5 ? 2 * lfo_phase2 : 2 - 2 * lfo_phase2;
-        
-        float pos = vibamt * lfo1;
-        int ipos = (int)pos;
-        float vl = lerp(line[vib[ipos]], line[vib[ipos + 1]], pos - ipos);
-        
-        pos = vibamt * lfo2;
-        ipos = (int)pos;
-        float vr = lerp(line[vib[ipos]], line[vib[ipos + 1]], pos - ipos);
+        unsigned int count = std::min<unsigned int>(len - start, scanner_line_box::MaxBlock);
+        float (*block)[2] = data + start;
+        float mono[scanner_line_box::MaxBlock];
+        float line[scanner_line_box::MaxBlock + scanner_line_box::Stages - 1][scanner_line_box::Lanes];
+        for (unsigned int i = 0; i < count; i++)
+            mono[i] = (block[i][0] + block[i][1]) * 0.5;
+        line_box.process(mono, line, count);
         
-        lfo_phase += dphase;
-        if (lfo_phase >= 1.0)
-            lfo_phase -= 1.0;
-        lfo_phase2 += dphase;
-        if (lfo_phase2 >= 1.0)
-            lfo_phase2 -= 1.0;
-        
-        data[i][0] += (vl - v0) * vib_wet;
-        data[i][1] += (vr - v0) * vib_wet;
-    }
-    for (int t = 0; t < ScannerSize; t++)
-    {
-        scanner[t].sanitize();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            float v0 = mono[i];
+            float lfo1 = lfo_phase < 0.5 ? 2 * lfo_phase : 2 - 2 * lfo_phase;
+            float lfo2 = lfo_phase2 < 0.5 ? 2 * lfo_phase2 : 2 - 2 * lfo_phase2;
+            
+            float pos = vibamt * lfo1;
+            int ipos = (int)pos;
+            float vl = lerp(line_tap(mono, line, vib[ipos], i), line_tap(mono, line, vib[ipos + 1], i), pos - ipos);
+            
+            pos = vibamt * lfo2;
+            ipos = (int)pos;
+            float vr = lerp(line_tap(mono, line, vib[ipos], i), line_tap(mono, line, vib[ipos + 1], i), pos - ipos);
+            
+            lfo_phase += dphase;
+            if (lfo_phase >= 1.0)
+                lfo_phase -= 1.0;
+            lfo_phase2 += dphase;
+            if (lfo_phase2 >= 1.0)
+                lfo_phase2 -= 1.0;
+            
+            block[i][0] += (vl - v0) * vib_wet;
+            block[i][1] += (vr - v0) * vib_wet;
+        }
     }
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -701,9 +1048,126 @@ void organ_voice::update_pitch()
     dphase.set(dsp::midi_note_to_phase(note, 100 * parameters->global_transpose + parameters->global_detune, sample_rate) * inertia_pitchbend.get_last());
 }
 
+/// Add len samples of a small (ORGAN_WAVE_SIZE) table to the planar left/right buffers with gains ampl/ampr.
+/// The table is read with linear interpolation at phase (12.20 fixed point), advancing by dphase.
+static void add_wave(const float *data, uint32_t phase, uint32_t dphase, float ampl, float ampr, float *left, float *right, int len)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i fmask = _mm_set1_epi32(0xFFFFF);
+    const __m128 fscale = _mm_set1_ps(1.f / 1048576), gl = _mm_set1_ps(ampl), gr = _mm_set1_ps(ampr);
+    const __m128i step = _mm_set1_epi32(4 * dphase);
+    __m128i ph = _mm_setr_epi32(phase, phase + dphase, phase + 2 * dphase, phase + 3 * dphase);
+    for (; i + 4 <= len; i += 4)
+    {
+        uint32_t pos[4];
+        _mm_storeu_si128((__m128i *)pos, _mm_srli_epi32(ph, 20));
+        __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(ph, fmask)), fscale);
+        // fetch both neighbours of each position with one 64-bit load, then split them
+        __m128 p01 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(data + pos[0])), (const __m64 *)(data + pos[1]));
+        __m128 p23 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(data + pos[2])), (const __m64 *)(data + pos[3]));
+        __m128 a = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 b = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 wv = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac));
+        _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(wv, gl)));
+        _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(wv, gr)));
+        ph = _mm_add_epi32(ph, step);
+    }
+    phase += i * dphase;
+#endif
+    for (; i < len; i++)
+    {
+        uint32_t pos = phase >> 20;
+        float wv = data[pos] + (data[pos + 1] - data[pos]) * ((phase & 0xFFFFF) * (1.f / 1048576));
+        left[i] += wv * ampl;
+        right[i] += wv * ampr;
+        phase += dphase;
+    }
+}
+
+/// Same as add_wave, for a big (ORGAN_BIG_WAVE_SIZE) table read at a 64-bit phase (20 fractional bits)
+static void add_big_wave(const float *data, uint64_t phase, uint64_t dphase, float ampl, float ampr, float *left, float *right, int len)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i pmask = _mm_set1_epi32(ORGAN_BIG_WAVE_SIZE - 1), fmask = _mm_set1_epi32(0xFFFFF);
+    const __m128 fscale = _mm_set1_ps(1.f / 1048576), gl = _mm_set1_ps(ampl), gr = _mm_set1_ps(ampr);
+    const __m128i step = _mm_set1_epi64x(4 * dphase);
+    __m128i ph01 = _mm_set_epi64x(phase + dphase, phase), ph23 = _mm_set_epi64x(phase + 3 * dphase, phase + 2 * dphase);
+    for (; i + 4 <= len; i += 4)
+    {
+        // only the low 32 bits of the phase and of the phase >> 20 matter, pack them into one register
+        __m128i lo = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(ph01), _mm_castsi128_ps(ph23), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i hi = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_srli_epi64(ph01, 20)), _mm_castsi128_ps(_mm_srli_epi64(ph23, 20)), _MM_SHUFFLE(2, 0, 2, 0)));
+        uint32_t pos[4];
+        _mm_storeu_si128((__m128i *)pos, _mm_and_si128(hi, pmask));
+        __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(lo, fmask)), fscale);
+        __m128 p01 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(data + pos[0])), (const __m64 *)(data + pos[1]));
+        __m128 p23 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(data + pos[2])), (const __m64 *)(data + pos[3]));
+        __m128 a = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 b = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 wv = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac));
+        _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(wv, gl)));
+        _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(wv, gr)));
+        ph01 = _mm_add_epi64(ph01, step);
+        ph23 = _mm_add_epi64(ph23, step);
+    }
+    phase += i * dphase;
+#endif
+    for (; i < len; i++)
+    {
+        uint32_t pos = (uint32_t)(phase >> 20) & (ORGAN_BIG_WAVE_SIZE - 1);
+        float wv = data[pos] + (data[pos + 1] - data[pos]) * ((phase & 0xFFFFF) * (1.f / 1048576));
+        left[i] += wv * ampl;
+        right[i] += wv * ampr;
+        phase += dphase;
+    }
+}
+
+/// Planar bus for the given routing target, cleared on first use within a block
+template<int Channels, int BlockSize>
+static inline float (*get_drawbar_bus(float (*buses)[Channels][BlockSize], unsigned int &used_buses, int routing))[BlockSize]
+{
+    if (!(used_buses & (1 << routing)))
+    {
+        dsp::zero(&buses[routing][0][0], Channels * BlockSize);
+        used_buses |= 1 << routing;
+    }
+    return buses[routing];
+}
+
 void organ_voice::render_block(int snapshot) {
-    if (note == -1)
+    if (!prepare_block())
         return;
+    filter_block();
+    finish_block();
+}
+
+void organ_voice::render_blocks(organ_voice **voices, int count, int snapshot)
+{
+    // the filters are the most expensive part of a voice, and a serial chain within it,
+    // so the filters of different voices share the SIMD registers instead
+    organ_voice *prepared[dsp::voice_slot_set::MaxSlots];
+    int nprepared = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (voices[i]->prepare_block())
+            prepared[nprepared++] = voices[i];
+    }
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= nprepared; i += 2)
+        filter_block_pair(prepared[i], prepared[i + 1]);
+#endif
+    for (; i < nprepared; i++)
+        prepared[i]->filter_block();
+    for (i = 0; i < nprepared; i++)
+        prepared[i]->finish_block();
+}
+
+bool organ_voice::prepare_block() {
+    if (note == -1)
+        return false;
 
     dsp::zero(&output_buffer[0][0], Channels * BlockSize);
     dsp::zero(&aux_buffers[1][0][0], 2 * Channels * BlockSize);
@@ -711,7 +1175,7 @@ void organ_voice::render_block(int snapshot) {
     {
         if (use_percussion())
             render_percussion_to(output_buffer, BlockSize);
-        return;
+        return false;
     }
 
     inertia_pitchbend.set_inertia(parameters->pitch_bend);
@@ -720,6 +1184,9 @@ void organ_voice::render_block(int snapshot) {
     dsp::fixed_point<int, 20> tphase, tdphase;
     unsigned int foldvalue = parameters->foldvalue * inertia_pitchbend.get_last();
     int vibrato_mode = fastf2i_drm(parameters->lfo_mode);
+    // drawbars are mixed into planar buses, one per routing target, interleaved afterwards
+    float buses[3][Channels][BlockSize];
+    unsigned int used_buses = 0;
     for (int h = 0; h < 9; h++)
     {
         float amp = parameters->drawbars[h];
@@ -743,14 +1210,8 @@ void organ_voice::render_block(int snapshot) {
             tdphase.set(rate >> ORGAN_BIG_WAVE_SHIFT);
             float ampl = amp * 0.5f * (1 - parameters->pan[h]);
             float ampr = amp * 0.5f * (1 + parameters->pan[h]);
-            float (*out)[Channels] = aux_buffers[dsp::fastf2i_drm(parameters->routing[h])];
-            
-            for (int i=0; i < (int)BlockSize; i++) {
-                float wv = big_wave(data, tphase);
-                out[i][0] += wv * ampl;
-                out[i][1] += wv * ampr;
-                tphase += tdphase;
-            }
+            float (*out)[BlockSize] = get_drawbar_bus(buses, used_buses, dsp::fastf2i_drm(parameters->routing[h]));
+            add_big_wave(data, tphase.get(), tdphase.get(), ampl, ampr, out[0], out[1], BlockSize);
         }
         else
         {
@@ -768,14 +1229,18 @@ void organ_voice::render_block(int snapshot) {
             tdphase.set((uint32_t)rate);
             float ampl = amp * 0.5f * (1 - parameters->pan[h]);
             float ampr = amp * 0.5f * (1 + parameters->pan[h]);
-            float (*out)[Channels] = aux_buffers[dsp::fastf2i_drm(parameters->routing[h])];
-            
-            for (int i=0; i < (int)BlockSize; i++) {
-                float wv = wave(data, tphase);
-                out[i][0] += wv * ampl;
-                out[i][1] += wv * ampr;
-                tphase += tdphase;
-            }
+            float (*out)[BlockSize] = get_drawbar_bus(buses, used_buses, dsp::fastf2i_drm(parameters->routing[h]));
+            add_wave(data, tphase.get(), tdphase.get(), ampl, ampr, out[0], out[1], BlockSize);
+        }
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        if (!(used_buses & (1 << r)))
+            continue;
+        for (int i = 0; i < (int)BlockSize; i++)
+        {
+            aux_buffers[r][i][0] = buses[r][0][i];
+            aux_buffers[r][i][1] = buses[r][1][i];
         }
     }
     
@@ -839,9 +1304,17 @@ void organ_voice::render_block(int snapshot) {
         finishing = true;
     // calculate delta from pre and post
     for (int i = 0; i < ampctl_count - 1; i++)
-        amp_post[i] = (amp_post[i] - amp_pre[i]) * (1.0 / BlockSize);
-    float a0 = amp_pre[0], a1 = amp_pre[1], a2 = amp_pre[2], a3 = amp_pre[3];
-    float d0 = amp_post[0], d1 = amp_post[1], d2 = amp_post[2], d3 = amp_post[3];
+    {
+        amp_start[i] = amp_pre[i];
+        amp_step[i] = (amp_post[i] - amp_pre[i]) * (1.0 / BlockSize);
+    }
+    return true;
+}
+
+void organ_voice::filter_block()
+{
+    float a0 = amp_start[0], a1 = amp_start[1], a2 = amp_start[2], a3 = amp_start[3];
+    float d0 = amp_step[0], d1 = amp_step[1], d2 = amp_step[2], d3 = amp_step[3];
     if (parameters->filter_chain >= 0.5f)
     {
         for (int i=0; i < (int) BlockSize; i++) {
@@ -858,6 +1331,104 @@ void organ_voice::render_block(int snapshot) {
             a0 += d0, a1 += d1, a2 += d2, a3 += d3;
         }
     }
+}
+
+#if defined(__SSE2__)
+/// Coefficients of one filter of two voices, one voice per lane
+struct organ_filter_lanes
+{
+    __m128d a0, a1, a2, b1, b2;
+    organ_filter_lanes(const dsp::biquad_d1 &f1, const dsp::biquad_d1 &f2)
+    : a0(_mm_set_pd(f2.a0, f1.a0)), a1(_mm_set_pd(f2.a1, f1.a1)), a2(_mm_set_pd(f2.a2, f1.a2))
+    , b1(_mm_set_pd(f2.b1, f1.b1)), b2(_mm_set_pd(f2.b2, f1.b2))
+    {
+    }
+};
+
+/// State of one filter (one channel) of two voices, one voice per lane
+struct organ_filter_state_lanes
+{
+    __m128d x1, x2, y1, y2;
+    dsp::biquad_d1 &f1, &f2;
+    organ_filter_state_lanes(dsp::biquad_d1 &_f1, dsp::biquad_d1 &_f2)
+    : x1(_mm_set_pd(_f2.x1, _f1.x1)), x2(_mm_set_pd(_f2.x2, _f1.x2)), y1(_mm_set_pd(_f2.y1, _f1.y1)), y2(_mm_set_pd(_f2.y2, _f1.y2))
+    , f1(_f1), f2(_f2)
+    {
+    }
+    /// same as biquad_d1::process
+    inline __m128d process(__m128d in, const organ_filter_lanes &c)
+    {
+        __m128d out = _mm_sub_pd(_mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(in, c.a0), _mm_mul_pd(x1, c.a1)), _mm_mul_pd(x2, c.a2)), _mm_mul_pd(y1, c.b1)), _mm_mul_pd(y2, c.b2));
+        x2 = x1;
+        y2 = y1;
+        x1 = in;
+        y1 = out;
+        return out;
+    }
+    ~organ_filter_state_lanes()
+    {
+        _mm_storel_pd(&f1.x1, x1); _mm_storeh_pd(&f2.x1, x1);
+        _mm_storel_pd(&f1.x2, x2); _mm_storeh_pd(&f2.x2, x2);
+        _mm_storel_pd(&f1.y1, y1); _mm_storeh_pd(&f2.y1, y1);
+        _mm_storel_pd(&f1.y2, y2); _mm_storeh_pd(&f2.y2, y2);
+    }
+};
+
+/// Load sample i of two interleaved stereo buffers as { L1, L2, R1, R2 }
+static inline __m128 load_voice_pair(const float (*buf1)[2], const float (*buf2)[2], int i)
+{
+    __m128 v = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)buf1[i]), (const __m64 *)buf2[i]);
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+/// Store left = { L1, L2 } and right = { R1, R2 } as sample i of two interleaved stereo buffers
+static inline void store_voice_pair(float (*buf1)[2], float (*buf2)[2], int i, __m128d left, __m128d right)
+{
+    __m128 v = _mm_unpacklo_ps(_mm_cvtpd_ps(left), _mm_cvtpd_ps(right));
+    _mm_storel_pi((__m64 *)buf1[i], v);
+    _mm_storeh_pi((__m64 *)buf2[i], v);
+}
+
+void organ_voice::filter_block_pair(organ_voice *v1, organ_voice *v2)
+{
+    organ_filter_lanes c0(v1->filterL[0], v2->filterL[0]), c1(v1->filterL[1], v2->filterL[1]);
+    organ_filter_state_lanes f0L(v1->filterL[0], v2->filterL[0]), f0R(v1->filterR[0], v2->filterR[0]);
+    organ_filter_state_lanes f1L(v1->filterL[1], v2->filterL[1]), f1R(v1->filterR[1], v2->filterR[1]);
+    // amplitude controls of both voices, ramped in single precision like in filter_block
+    __m128 amp1 = _mm_loadu_ps(v1->amp_start), amp2 = _mm_loadu_ps(v2->amp_start);
+    __m128 step1 = _mm_loadu_ps(v1->amp_step), step2 = _mm_loadu_ps(v2->amp_step);
+    bool chain = v1->parameters->filter_chain >= 0.5f;
+    for (int i = 0; i < (int)BlockSize; i++)
+    {
+        // { a0 of v1, a0 of v2, a1 of v1, a1 of v2 } and the same for a2, a3
+        __m128 amp01 = _mm_unpacklo_ps(amp1, amp2), amp23 = _mm_unpackhi_ps(amp1, amp2);
+        __m128d a1 = _mm_cvtps_pd(_mm_movehl_ps(amp01, amp01));
+        __m128d a2 = _mm_cvtps_pd(amp23), a3 = _mm_cvtps_pd(_mm_movehl_ps(amp23, amp23));
+        // the direct signal is scaled in single precision, like in filter_block
+        __m128 direct = _mm_mul_ps(load_voice_pair(v1->output_buffer, v2->output_buffer, i), _mm_movelh_ps(amp01, amp01));
+        __m128 in1 = load_voice_pair(v1->aux_buffers[1], v2->aux_buffers[1], i);
+        __m128 in2 = load_voice_pair(v1->aux_buffers[2], v2->aux_buffers[2], i);
+        __m128d outL, outR;
+        if (chain)
+        {
+            outL = _mm_mul_pd(a3, _mm_add_pd(_mm_cvtps_pd(direct), _mm_mul_pd(a2, f1L.process(_mm_add_pd(_mm_mul_pd(a1, f0L.process(_mm_cvtps_pd(in1), c0)), _mm_cvtps_pd(in2)), c1))));
+            outR = _mm_mul_pd(a3, _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(direct, direct)), _mm_mul_pd(a2, f1R.process(_mm_add_pd(_mm_mul_pd(a1, f0R.process(_mm_cvtps_pd(_mm_movehl_ps(in1, in1)), c0)), _mm_cvtps_pd(_mm_movehl_ps(in2, in2))), c1))));
+        }
+        else
+        {
+            outL = _mm_mul_pd(a3, _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(direct), _mm_mul_pd(a1, f0L.process(_mm_cvtps_pd(in1), c0))), _mm_mul_pd(a2, f1L.process(_mm_cvtps_pd(in2), c1))));
+            outR = _mm_mul_pd(a3, _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(direct, direct)), _mm_mul_pd(a1, f0R.process(_mm_cvtps_pd(_mm_movehl_ps(in1, in1)), c0))), _mm_mul_pd(a2, f1R.process(_mm_cvtps_pd(_mm_movehl_ps(in2, in2)), c1))));
+        }
+        store_voice_pair(v1->output_buffer, v2->output_buffer, i, outL, outR);
+        amp1 = _mm_add_ps(amp1, step1);
+        amp2 = _mm_add_ps(amp2, step2);
+    }
+}
+#endif
+
+void organ_voice::finish_block()
+{
+    int vibrato_mode = fastf2i_drm(parameters->lfo_mode);
     filterL[0].sanitize();
     filterR[0].sanitize();
     filterL[1].sanitize();
@@ -986,7 +1557,7 @@ bool drawbar_organ::check_percussion() {
 void drawbar_organ::pitch_bend(int amt)
 {
     parameters->pitch_bend = pow(2.0, (amt * parameters->pitch_bend_range) / (1200.0 * 8192.0));
-    for (voice_array::iterator i = active_voices.begin(); i != active_voices.end(); ++i)
+    for_all_voices(i)
     {
         organ_voice *v = dynamic_cast<organ_voice *>(*i);
         v->update_pitch();
@@ -1078,7 +1649,7 @@ void drawbar_organ::render_separate(float *output[], int nsamples)
 {
     float buf[MAX_SAMPLE_RUN][2];
     dsp::zero(&buf[0][0], 2 * nsamples);
-    basic_synth::render_to(buf, nsamples);
+    render_block_voices_to<organ_voice>(buf, nsamples);
     if (dsp::fastf2i_drm(parameters->lfo_mode) == organ_voice_base::lfomode_global)
     {
         for (int i = 0; i < nsamples; i += 64)
@@ -149,6 +149,7 @@ void preset_list::plugin_snapshot::reset()
 {
     type.clear();
     instance_name.clear();
+    internal_source.clear();
     preset_offset = input_index = output_index = midi_index = 0;
     automation_entries.clear();
 }
@@ -185,6 +186,8 @@ void preset_list::xml_start_element_handler(void *user_data, const char *name, c
                 if (!strcmp(attrs[0], "output-index")) self.parser_plugin.output_index = atoi(attrs[1]);
                 else
                 if (!strcmp(attrs[0], "midi-index")) self.parser_plugin.midi_index = atoi(attrs[1]);
+                else
+                if (!strcmp(attrs[0], "internal-source")) self.parser_plugin.internal_source = attrs[1];
             }
             state = PLUGIN;
             return;
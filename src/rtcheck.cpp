@@ -0,0 +1,606 @@
+/* Calf DSP Library
+ * Realtime safety checker - runs all plugins with the heap, locks, stdio
+ * and blocking system calls trapped while audio processing code runs.
+ * Copyright (C) 2007-2011 Krzysztof Foltman and others.
+ * See AUTHORS file for a complete list.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+// the hooks below must replace the real functions, not the fortified inline wrappers
+#undef _FORTIFY_SOURCE
+
+#include <calf/giface.h>
+#include <calf/modules_tools.h>
+#include <calf/modules_delay.h>
+#include <calf/modules_comp.h>
+#include <calf/modules_limit.h>
+#include <calf/modules_dev.h>
+#include <calf/modules_dist.h>
+#include <calf/modules_filter.h>
+#include <calf/modules_mod.h>
+#include <calf/modules_pitch.h>
+#include <calf/modules_synths.h>
+#include <calf/organ.h>
+#include <alloca.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace calf_plugins;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum rt_violation_kind { RTV_ALLOC, RTV_FREE, RTV_LOCK, RTV_STDIO, RTV_FILE, RTV_SLEEP, RTV_COUNT };
+
+static const char *rt_violation_names[RTV_COUNT] = { "alloc", "free", "lock", "stdio", "file", "sleep" };
+
+/// Set while the checked (audio thread) code runs
+static __thread bool rt_tracking = false;
+/// Nesting level of hooks - calls made by the real functions, or by the reporting code, are not counted
+static __thread int rt_in_hook = 0;
+/// Name of the function being checked, for the report
+static const char *rt_context = "";
+static const char *rt_plugin = "";
+static unsigned int rt_counts[RTV_COUNT];
+
+enum { seen_table_size = 4096, max_frames = 24 };
+/// Hashes of call stacks that were already reported (open addressing, no heap use)
+static uint32_t seen_stacks[seen_table_size];
+
+struct rt_hook_guard
+{
+    rt_hook_guard() { rt_in_hook++; }
+    ~rt_hook_guard() { rt_in_hook--; }
+};
+
+static void rt_report(const char *buf)
+{
+    ssize_t res = write(2, buf, strlen(buf));
+    (void)res;
+}
+
+static bool rt_first_seen(void **frames, int count)
+{
+    uint32_t hash = 2166136261U;
+    for (int i = 0; i < count; i++)
+        hash = (hash ^ (uint32_t)(uintptr_t)frames[i]) * 16777619U;
+    if (!hash)
+        hash = 1;
+    for (uint32_t i = 0; i < seen_table_size; i++)
+    {
+        uint32_t &slot = seen_stacks[(hash + i) & (seen_table_size - 1)];
+        if (slot == hash)
+            return false;
+        if (!slot)
+        {
+            slot = hash;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void rt_violation(rt_violation_kind kind, const char *func, size_t arg)
+{
+    if (!rt_tracking || rt_in_hook)
+        return;
+    rt_hook_guard guard;
+    rt_counts[kind]++;
+    void *frames[max_frames];
+    int count = backtrace(frames, max_frames);
+    if (!rt_first_seen(frames, count))
+        return;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s: %s(%lu) [%s] inside %s\n", rt_plugin, func, (unsigned long)arg, rt_violation_names[kind], rt_context);
+    rt_report(buf);
+    // skip the frames of rt_violation and the hook itself
+    backtrace_symbols_fd(frames + 2, count - 2, 2);
+    rt_report("\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interposed functions
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) __THROW
+{
+    rt_violation(RTV_ALLOC, "malloc", size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) __THROW
+{
+    rt_violation(RTV_ALLOC, "calloc", nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) __THROW
+{
+    rt_violation(RTV_ALLOC, "realloc", size);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) __THROW
+{
+    rt_violation(RTV_ALLOC, "posix_memalign", size);
+    *memptr = __libc_memalign(alignment, size);
+    return *memptr ? 0 : ENOMEM;
+}
+
+void free(void *ptr) __THROW
+{
+    if (ptr)
+        rt_violation(RTV_FREE, "free", 0);
+    __libc_free(ptr);
+}
+
+}
+
+/// Pointers to the real versions of the functions below. They are resolved before any checking
+/// starts, but a hook called earlier than that (from a static initialiser) resolves its own on demand.
+static struct real_functions
+{
+    int (*pthread_mutex_lock)(pthread_mutex_t *);
+    int (*pthread_rwlock_rdlock)(pthread_rwlock_t *);
+    int (*pthread_rwlock_wrlock)(pthread_rwlock_t *);
+    int (*pthread_cond_wait)(pthread_cond_t *, pthread_mutex_t *);
+    int (*sem_wait)(sem_t *);
+    int (*vfprintf)(FILE *, const char *, va_list);
+    int (*fputs)(const char *, FILE *);
+    int (*puts)(const char *);
+    size_t (*fwrite)(const void *, size_t, size_t, FILE *);
+    int (*fflush)(FILE *);
+    FILE *(*fopen)(const char *, const char *);
+    int (*open)(const char *, int, ...);
+    ssize_t (*read)(int, void *, size_t);
+    ssize_t (*write)(int, const void *, size_t);
+    int (*usleep)(useconds_t);
+    int (*nanosleep)(const struct timespec *, struct timespec *);
+} real_fn;
+
+template<class Func>
+static void resolve(Func &func, const char *name)
+{
+    func = (Func)dlsym(RTLD_NEXT, name);
+    if (!func)
+    {
+        fprintf(stderr, "Cannot resolve %s: %s\n", name, dlerror());
+        exit(2);
+    }
+}
+
+/// @return the real function, looked up on first use if resolve_real_functions has not run yet
+template<class Func>
+static inline Func lazy_resolve(Func &func, const char *name)
+{
+    if (!func)
+    {
+        func = (Func)dlsym(RTLD_NEXT, name);
+        if (!func)
+        {
+            rt_report("Cannot resolve ");
+            rt_report(name);
+            rt_report("\n");
+            abort();
+        }
+    }
+    return func;
+}
+
+#define REAL_FN(func) lazy_resolve(real_fn.func, #func)
+
+static void resolve_real_functions()
+{
+    resolve(real_fn.pthread_mutex_lock, "pthread_mutex_lock");
+    resolve(real_fn.pthread_rwlock_rdlock, "pthread_rwlock_rdlock");
+    resolve(real_fn.pthread_rwlock_wrlock, "pthread_rwlock_wrlock");
+    resolve(real_fn.pthread_cond_wait, "pthread_cond_wait");
+    resolve(real_fn.sem_wait, "sem_wait");
+    resolve(real_fn.vfprintf, "vfprintf");
+    resolve(real_fn.fputs, "fputs");
+    resolve(real_fn.puts, "puts");
+    resolve(real_fn.fwrite, "fwrite");
+    resolve(real_fn.fflush, "fflush");
+    resolve(real_fn.fopen, "fopen");
+    resolve(real_fn.open, "open");
+    resolve(real_fn.read, "read");
+    resolve(real_fn.write, "write");
+    resolve(real_fn.usleep, "usleep");
+    resolve(real_fn.nanosleep, "nanosleep");
+}
+
+#define RT_HOOK(kind, func, arg) rt_violation(kind, func, arg); rt_hook_guard guard;
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) __THROWNL
+{
+    RT_HOOK(RTV_LOCK, "pthread_mutex_lock", 0)
+    return REAL_FN(pthread_mutex_lock)(mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) __THROWNL
+{
+    RT_HOOK(RTV_LOCK, "pthread_rwlock_rdlock", 0)
+    return REAL_FN(pthread_rwlock_rdlock)(rwlock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) __THROWNL
+{
+    RT_HOOK(RTV_LOCK, "pthread_rwlock_wrlock", 0)
+    return REAL_FN(pthread_rwlock_wrlock)(rwlock);
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    RT_HOOK(RTV_LOCK, "pthread_cond_wait", 0)
+    return REAL_FN(pthread_cond_wait)(cond, mutex);
+}
+
+int sem_wait(sem_t *sem)
+{
+    RT_HOOK(RTV_LOCK, "sem_wait", 0)
+    return REAL_FN(sem_wait)(sem);
+}
+
+int printf(const char *format, ...)
+{
+    RT_HOOK(RTV_STDIO, "printf", 0)
+    va_list ap;
+    va_start(ap, format);
+    int res = REAL_FN(vfprintf)(stdout, format, ap);
+    va_end(ap);
+    return res;
+}
+
+int fprintf(FILE *stream, const char *format, ...)
+{
+    RT_HOOK(RTV_STDIO, "fprintf", 0)
+    va_list ap;
+    va_start(ap, format);
+    int res = REAL_FN(vfprintf)(stream, format, ap);
+    va_end(ap);
+    return res;
+}
+
+int vfprintf(FILE *stream, const char *format, va_list ap)
+{
+    RT_HOOK(RTV_STDIO, "vfprintf", 0)
+    return REAL_FN(vfprintf)(stream, format, ap);
+}
+
+int fputs(const char *s, FILE *stream)
+{
+    RT_HOOK(RTV_STDIO, "fputs", strlen(s))
+    return REAL_FN(fputs)(s, stream);
+}
+
+int puts(const char *s)
+{
+    RT_HOOK(RTV_STDIO, "puts", strlen(s))
+    return REAL_FN(puts)(s);
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    RT_HOOK(RTV_STDIO, "fwrite", size * nmemb)
+    return REAL_FN(fwrite)(ptr, size, nmemb, stream);
+}
+
+int fflush(FILE *stream)
+{
+    RT_HOOK(RTV_STDIO, "fflush", 0)
+    return REAL_FN(fflush)(stream);
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    RT_HOOK(RTV_FILE, "fopen", 0)
+    return REAL_FN(fopen)(path, mode);
+}
+
+int open(const char *path, int flags, ...)
+{
+    RT_HOOK(RTV_FILE, "open", 0)
+    // the mode argument is only passed when a file may be created
+    int mode = 0;
+#ifdef O_TMPFILE
+    if (flags & (O_CREAT | O_TMPFILE))
+#else
+    if (flags & O_CREAT)
+#endif
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+    return REAL_FN(open)(path, flags, mode);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    RT_HOOK(RTV_FILE, "read", count)
+    return REAL_FN(read)(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    RT_HOOK(RTV_FILE, "write", count)
+    return REAL_FN(write)(fd, buf, count);
+}
+
+int usleep(useconds_t usec)
+{
+    RT_HOOK(RTV_SLEEP, "usleep", usec)
+    return REAL_FN(usleep)(usec);
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    RT_HOOK(RTV_SLEEP, "nanosleep", req->tv_sec * 1000000000UL + req->tv_nsec)
+    return REAL_FN(nanosleep)(req, rem);
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stack depth probe
+
+enum { stack_probe_size = 256 * 1024, stack_probe_fill = 0xA5 };
+
+/// Fill the probe area with a known pattern (paint = true), or count how many bytes of it, from
+/// the far end, no longer hold the pattern
+static unsigned int __attribute__((noinline)) stack_probe_area(volatile unsigned char *area, bool paint)
+{
+    if (paint)
+    {
+        for (int i = 0; i < stack_probe_size; i++)
+            area[i] = stack_probe_fill;
+        return 0;
+    }
+    int i = 0;
+    while(i < stack_probe_size && area[i] == stack_probe_fill)
+        i++;
+    return stack_probe_size - i;
+}
+
+/// Allocate the probe area right below the caller's frame, so that painting and measuring from
+/// the same place in the same function always cover the same memory
+static unsigned int __attribute__((noinline)) stack_probe(bool paint)
+{
+    volatile unsigned char *area = (volatile unsigned char *)alloca(stack_probe_size);
+    return stack_probe_area(area, paint);
+}
+
+/// Fill the unused stack area below the caller with a known pattern
+static inline void paint_stack()
+{
+    stack_probe(true);
+}
+
+/// @return number of bytes below the caller overwritten since paint_stack was called from the same place
+static inline unsigned int measure_stack()
+{
+    return stack_probe(false);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Plugin driver
+
+static unsigned int block_size = 256;
+static unsigned int stack_limit = 16384;
+static unsigned int max_stack;
+
+/// Run a module function that a host calls on the audio thread, with trapping enabled
+#define RT_CHECKED(context, call) \
+    { \
+        rt_context = context; \
+        paint_stack(); \
+        rt_tracking = true; \
+        call; \
+        rt_tracking = false; \
+        max_stack = std::max(max_stack, measure_stack()); \
+    }
+
+struct plugin_checker
+{
+    audio_module_iface *module;
+    const plugin_metadata_iface *metadata;
+    vector<float> inputs, outputs, params;
+
+    plugin_checker(audio_module_iface *_module)
+    : module(_module)
+    , metadata(_module->get_metadata_iface())
+    , inputs(metadata->get_input_count() * block_size)
+    , outputs(metadata->get_output_count() * block_size)
+    , params(metadata->get_param_count())
+    {
+        float **ins, **outs, **pars;
+        module->get_port_arrays(ins, outs, pars);
+        for (int b = 0; b < metadata->get_input_count(); b++)
+        {
+            ins[b] = &inputs[b * block_size];
+            for (unsigned int i = 0; i < block_size; i++)
+                ins[b][i] = 0.5f * sin(i * (0.05f + 0.01f * b)) + 0.01f * (rand() % 100 - 50);
+        }
+        for (int b = 0; b < metadata->get_output_count(); b++)
+            outs[b] = &outputs[b * block_size];
+        for (int i = 0; i < metadata->get_param_count(); i++)
+        {
+            params[i] = metadata->get_param_props(i)->def_value;
+            pars[i] = &params[i];
+        }
+    }
+    void run_block()
+    {
+        RT_CHECKED("params_changed", module->params_changed());
+        RT_CHECKED("process_slice", module->process_slice(0, block_size));
+        module->params_reset();
+    }
+    /// Set every input parameter, one at a time, to a spread of values over its range
+    void sweep_params()
+    {
+        for (int i = 0; i < metadata->get_param_count(); i++)
+        {
+            const parameter_properties &props = *metadata->get_param_props(i);
+            if (props.flags & PF_PROP_OUTPUT)
+                continue;
+            vector<float> values;
+            int type = props.flags & PF_TYPEMASK;
+            if (type != PF_FLOAT && props.max - props.min < 32)
+            {
+                for (float v = props.min; v <= props.max; v++)
+                    values.push_back(v);
+            }
+            else
+            {
+                for (int j = 0; j <= 4; j++)
+                    values.push_back(props.from_01(j * 0.25));
+            }
+            for (size_t j = 0; j < values.size(); j++)
+            {
+                params[i] = values[j];
+                run_block();
+                run_block();
+            }
+            params[i] = props.def_value;
+            run_block();
+        }
+    }
+};
+
+static bool check_plugin(audio_module_iface *module, const char *name, bool is_synth)
+{
+    memset(rt_counts, 0, sizeof(rt_counts));
+    max_stack = 0;
+    rt_plugin = name;
+    {
+        plugin_checker checker(module);
+        // these are not realtime calls in any of the hosts
+        module->post_instantiate(44100);
+        module->set_sample_rate(44100);
+        module->activate();
+        module->params_changed();
+
+        checker.run_block();
+        if (is_synth)
+        {
+            RT_CHECKED("note_on", module->note_on(0, 60, 100));
+            RT_CHECKED("note_on", module->note_on(0, 64, 100));
+            RT_CHECKED("note_on", module->note_on(0, 67, 100));
+        }
+        checker.sweep_params();
+        if (is_synth)
+        {
+            RT_CHECKED("note_off", module->note_off(0, 60, 0));
+            RT_CHECKED("note_off", module->note_off(0, 64, 0));
+            RT_CHECKED("note_off", module->note_off(0, 67, 0));
+            checker.run_block();
+        }
+        module->deactivate();
+    }
+    delete module;
+
+    bool failed = max_stack > stack_limit;
+    printf("%-22s", name);
+    for (int i = 0; i < RTV_COUNT; i++)
+    {
+        printf(" %s:%u", rt_violation_names[i], rt_counts[i]);
+        if (rt_counts[i])
+            failed = true;
+    }
+    printf(" stack:%u%s\n", max_stack, failed ? " FAILED" : "");
+    fflush(stdout);
+    return !failed;
+}
+
+static struct option long_options[] = {
+    {"help", 0, 0, 'h'},
+    {"version", 0, 0, 'v'},
+    {"plugin", 1, 0, 'p'},
+    {"blocksize", 1, 0, 'b'},
+    {"stack", 1, 0, 's'},
+    {0,0,0,0},
+};
+
+int main(int argc, char *argv[])
+{
+    const char *plugin = NULL;
+    while(1) {
+        int option_index;
+        int c = getopt_long(argc, argv, "p:b:s:hv", long_options, &option_index);
+        if (c == -1)
+            break;
+        switch(c) {
+            case 'h':
+            case '?':
+                printf("Realtime safety checker for Calf plugin pack\nSyntax: %s [--help] [--version] [--plugin <name>] [--blocksize N] [--stack <bytes>]\n", argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", PACKAGE_STRING);
+                return 0;
+            case 'p':
+                plugin = optarg;
+                break;
+            case 'b':
+                block_size = std::max(1, atoi(optarg));
+                break;
+            case 's':
+                stack_limit = atoi(optarg);
+                break;
+        }
+    }
+    resolve_real_functions();
+    // the first backtrace call loads libgcc, do it before anything is trapped
+    void *frames[max_frames];
+    backtrace(frames, max_frames);
+
+    int failed = 0, checked = 0;
+    #define PER_MODULE_ITEM(name, isSynth, jackname) \
+        if (!plugin || !strcasecmp(plugin, jackname)) { \
+            if (!check_plugin(new name##_audio_module, jackname, isSynth)) \
+                failed++; \
+            checked++; \
+        }
+    #include <calf/modulelist.h>
+
+    if (!checked)
+    {
+        fprintf(stderr, "Unknown plugin: %s\n", plugin);
+        return 2;
+    }
+    printf("%d of %d plugins failed the realtime safety check\n", failed, checked);
+    return failed ? 1 : 0;
+}
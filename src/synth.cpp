@@ -25,15 +25,15 @@ using namespace std;
 
 void basic_synth::init_voices(int count)
 {
+    assert(count <= voice_slot_set::MaxSlots);
     allocated_voices.init(count);
-    active_voices.init(count);
-    unused_voices.init(count);
     for (int i = 0; i < count; i++)
     {
-        dsp::voice *v = alloc_voice();
-        allocated_voices.add(v);
-        unused_voices.add(v);
+        allocated_voices.add(alloc_voice());
+        unused_voices.push(i);
+        voice_serials[i] = 0;
     }
+    next_voice_serial = 0;
 }
 
 void basic_synth::kill_note(int note, int vel, bool just_one)
@@ -48,38 +48,44 @@ void basic_synth::kill_note(int note, int vel, bool just_one)
     }
 }
 
-dsp::voice *basic_synth::give_voice()
+int basic_synth::give_voice_slot()
 {
     if (active_voices.size() >= polyphony_limit)
         steal_voice();
-    if (unused_voices.empty())
-        return NULL;
-    else {
-        dsp::voice *v = unused_voices.pop();
-        v->reset();
-        return v;
-    }   
+    int slot = unused_voices.pop();
+    if (slot >= 0)
+        allocated_voices.items[slot]->reset();
+    return slot;
+}
+
+dsp::voice *basic_synth::give_voice()
+{
+    int slot = give_voice_slot();
+    return slot < 0 ? NULL : allocated_voices.items[slot];
 }
 
 void basic_synth::steal_voice()
 {
-    dsp::voice *found = NULL;
+    int found = -1;
     float priority = 10000;
     //int idx = 0;
     for_all_voices(i)
     {
         //printf("Voice %d priority %f at %p\n", idx++, (*i)->get_priority(), *i);
-        if ((*i)->get_priority() < priority)
+        int slot = i - allocated_voices.items;
+        float p = (*i)->get_priority();
+        // of the voices with the same priority, the one started first is stolen
+        if (p < priority || (p == priority && found >= 0 && (int32_t)(voice_serials[slot] - voice_serials[found]) < 0))
         {
-            priority = (*i)->get_priority();
-            found = *i;
+            priority = p;
+            found = slot;
         }
     }
-    //printf("Found: %p\n\n", *found);
-    if (!found)
+    //printf("Found: %d\n\n", found);
+    if (found < 0)
         return;
     
-    found->steal();
+    allocated_voices.items[found]->steal();
 }
 
 void basic_synth::trim_voices()
@@ -106,15 +112,17 @@ void basic_synth::note_on(int note, int vel)
         return;
     }
     bool perc = check_percussion();
-    dsp::voice *v = give_voice();
-    if (!v)
+    int slot = give_voice_slot();
+    if (slot < 0)
         return;
+    dsp::voice *v = allocated_voices.items[slot];
     v->setup(sample_rate);
     v->released = false;
     v->sostenuto = false;
     gate.set(note);
     v->note_on(note, vel);
-    active_voices.add(v);
+    active_voices.add(slot);
+    voice_serials[slot] = next_voice_serial++;
     if (perc) {
         percussion_note_on(note, vel);
     }
@@ -203,16 +211,15 @@ void basic_synth::control_change(int ctl, int val)
 void basic_synth::render_to(float (*output)[2], int nsamples)
 {
     // render voices, eliminate ones that aren't sounding anymore
-    for (dsp::voice **i = active_voices.begin(); i != active_voices.end(); ) {
-        dsp::voice *v = *i;
+    uint64_t finished = 0;
+    for (uint64_t mask = active_voices.bits; mask; mask &= mask - 1) {
+        int slot = __builtin_ctzll(mask);
+        dsp::voice *v = allocated_voices.items[slot];
         v->render_to(output, nsamples);
-        if (!v->get_active()) {
-            i = active_voices.erase(i);
-            unused_voices.add(v);
-            continue;
-        }
-        i++;
+        if (!v->get_active())
+            finished |= 1ULL << slot;
     }
+    free_voices(finished);
 } 
 
 basic_synth::~basic_synth()